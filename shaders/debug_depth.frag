@@ -6,6 +6,7 @@ in vec2 TexCoords;
 uniform sampler2D depthMap;
 uniform float near_plane;
 uniform float far_plane;
+uniform float uvScale; // fraction of the depth map in use
 
 // Linearize depth value
 float LinearizeDepth(float depth)
@@ -16,7 +17,7 @@ float LinearizeDepth(float depth)
 
 void main()
 {             
-    float depthValue = texture(depthMap, TexCoords).r;
+    float depthValue = texture(depthMap, TexCoords * uvScale).r;
     // For orthographic projection (shadow map), depth is already linear
     // But we can still visualize it
     FragColor = vec4(vec3(depthValue), 1.0);
@@ -1,9 +1,17 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
+// Light space for the shadow pass, camera projection * view for the depth
+// prepass. Must be computed exactly like shadow.vert so GL_EQUAL passes.
+uniform mat4 viewProjection;
+
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+    vec4 objectColor;
+};
+
+invariant gl_Position;
 
 void main() {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * (model * vec4(aPos, 1.0));
 }
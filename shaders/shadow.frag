@@ -1,48 +1,72 @@
 #version 330 core
 out vec4 FragColor;
 
+// Compiled as permutations (see ShaderPermutations.h). The host defines
+//   POINT_LIGHT     point light with distance attenuation (else directional)
+//   ENABLE_SHADOWS  shadow map lookup (else fully lit)
+//   MULTI_VIEW      eye position comes from the vertex shader, per view
+// from the current settings; lightType and enableShadows in FrameBlock are
+// only informational.
+
 in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec4 FragPosLightSpace;
+#ifdef MULTI_VIEW
+    flat vec3 ViewPos;
+#endif
 } fs_in;
 
 uniform sampler2D shadowMap;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 objectColor;
-
-// Light properties
-uniform int lightType; // 0 = directional, 1 = point
-uniform float constant;
-uniform float linear;
-uniform float quadratic;
+// Per-frame and per-object data, streamed through uniform buffers
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    mat4 viewProjection; // projection * view, computed on the CPU
+    mat4 lightSpaceMatrix;
+    vec4 viewPos;
+    vec4 lightPos;
+    int lightType; // 0 = directional, 1 = point
+    float constant;
+    float linear;
+    float quadratic;
+    float ambientStrength;
+    float specularStrength;
+    int shininess;
+    float shadowBias;
+    bool enableShadows;
+    float shadowMapScale; // fraction of the shadow map in use
+};
 
-// Lighting parameters
-uniform float ambientStrength;
-uniform float specularStrength;
-uniform int shininess;
-uniform float shadowBias;
-uniform bool enableShadows;
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+    vec4 objectColor;
+};
 
 float ShadowCalculation(vec4 fragPosLightSpace)
 {
-    if (!enableShadows) return 0.0;
-    
+#ifndef ENABLE_SHADOWS
+    return 0.0;
+#else
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     projCoords = projCoords * 0.5 + 0.5;
-    float closestDepth = texture(shadowMap, projCoords.xy).r; 
+    // Only the lower-left shadowMapScale of the texture holds this frame's
+    // depth, so the border color can't be relied on outside the light frustum
+    if (projCoords.x < 0.0 || projCoords.x > 1.0 || projCoords.y < 0.0 || projCoords.y > 1.0)
+        return 0.0;
+    float closestDepth = texture(shadowMap, projCoords.xy * shadowMapScale).r; 
     float currentDepth = projCoords.z;
     float shadow = currentDepth - shadowBias > closestDepth  ? 1.0 : 0.0;
     if(projCoords.z > 1.0)
         shadow = 0.0;
     return shadow;
+#endif
 }
 
 void main()
 {           
-    vec3 color = objectColor;
+    vec3 color = objectColor.rgb;
     vec3 normal = normalize(fs_in.Normal);
     vec3 lightColor = vec3(1.0);
     
@@ -53,21 +77,25 @@ void main()
     vec3 lightDir;
     float attenuation = 1.0;
     
-    if (lightType == 0) {
-        // Directional light
-        lightDir = normalize(lightPos - fs_in.FragPos);
-    } else {
-        // Point light with attenuation
-        lightDir = normalize(lightPos - fs_in.FragPos);
-        float distance = length(lightPos - fs_in.FragPos);
-        attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
-    }
+#ifndef POINT_LIGHT
+    // Directional light
+    lightDir = normalize(lightPos.xyz - fs_in.FragPos);
+#else
+    // Point light with attenuation
+    lightDir = normalize(lightPos.xyz - fs_in.FragPos);
+    float distance = length(lightPos.xyz - fs_in.FragPos);
+    attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+#endif
     
     float diff = max(dot(lightDir, normal), 0.0);
     vec3 diffuse = diff * lightColor;
     
     // Specular
-    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+#ifdef MULTI_VIEW
+    vec3 viewDir = normalize(fs_in.ViewPos - fs_in.FragPos);
+#else
+    vec3 viewDir = normalize(viewPos.xyz - fs_in.FragPos);
+#endif
     vec3 halfwayDir = normalize(lightDir + viewDir);  
     float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
     vec3 specular = specularStrength * spec * lightColor;
@@ -1,4 +1,10 @@
 #version 330 core
+// Compiled as permutations like shadow.frag. MULTI_VIEW draws one instance
+// per view into that view's tile of the multi-view target; VIEWPORT_ARRAY
+// routes instances with gl_ViewportIndex instead of remapping clip space.
+#ifdef VIEWPORT_ARRAY
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 
@@ -6,16 +12,75 @@ out VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec4 FragPosLightSpace;
+#ifdef MULTI_VIEW
+    flat vec3 ViewPos;
+#endif
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+// Per-frame and per-object data, streamed through uniform buffers
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    mat4 viewProjection; // projection * view, computed on the CPU
+    mat4 lightSpaceMatrix;
+    vec4 viewPos;
+    vec4 lightPos;
+    int lightType;
+    float constant;
+    float linear;
+    float quadratic;
+    float ambientStrength;
+    float specularStrength;
+    int shininess;
+    float shadowBias;
+    bool enableShadows;
+    float shadowMapScale; // fraction of the shadow map in use
+};
+
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+    vec4 objectColor;
+};
+
+#ifdef MULTI_VIEW
+const int MAX_VIEWS = 16;
+
+layout (std140) uniform ViewBlock {
+    mat4 viewProjections[MAX_VIEWS];
+    vec4 viewPositions[MAX_VIEWS];
+    vec4 viewRects[MAX_VIEWS]; // xy: NDC scale, zw: NDC offset of the view's tile
+};
+
+#ifndef VIEWPORT_ARRAY
+out float gl_ClipDistance[4];
+#endif
+#endif
+
+// Same expression as depth.vert, so the lit pass can use GL_EQUAL against
+// the depth prepass
+invariant gl_Position;
 
 void main() {
-    vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    vs_out.FragPos = worldPos.xyz;
     vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;
-    vs_out.FragPosLightSpace = lightSpaceMatrix * vec4(vs_out.FragPos, 1.0);
-    gl_Position = projection * view * vec4(vs_out.FragPos, 1.0);
+    vs_out.FragPosLightSpace = lightSpaceMatrix * worldPos;
+#ifndef MULTI_VIEW
+    gl_Position = viewProjection * (model * vec4(aPos, 1.0));
+#else
+    int view = gl_InstanceID;
+    vs_out.ViewPos = viewPositions[view].xyz;
+    vec4 clipPos = viewProjections[view] * worldPos;
+#ifdef VIEWPORT_ARRAY
+    gl_ViewportIndex = view;
+    gl_Position = clipPos;
+#else
+    // Squeeze the view's clip volume into its tile and clip at the tile edges
+    gl_ClipDistance[0] = clipPos.w + clipPos.x;
+    gl_ClipDistance[1] = clipPos.w - clipPos.x;
+    gl_ClipDistance[2] = clipPos.w + clipPos.y;
+    gl_ClipDistance[3] = clipPos.w - clipPos.y;
+    gl_Position = vec4(clipPos.xy * viewRects[view].xy + viewRects[view].zw * clipPos.w, clipPos.zw);
+#endif
+#endif
 }
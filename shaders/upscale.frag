@@ -0,0 +1,33 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sceneColor;
+uniform vec2 uvScale;    // rendered region / texture size
+uniform vec2 texelSize;  // 1.0 / texture size
+uniform float sharpness; // 0 = plain bilinear upscale
+
+// Keep samples inside the rendered region of the texture
+vec3 sampleScene(vec2 uv)
+{
+    return texture(sceneColor, clamp(uv, 0.5 * texelSize, uvScale - 0.5 * texelSize)).rgb;
+}
+
+void main()
+{
+    vec2 uv = TexCoords * uvScale;
+    vec3 center = sampleScene(uv);
+    if (sharpness <= 0.0) {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    // Unsharp mask to recover some of the detail lost to bilinear filtering
+    vec3 blur = (sampleScene(uv + vec2(texelSize.x, 0.0)) +
+                 sampleScene(uv - vec2(texelSize.x, 0.0)) +
+                 sampleScene(uv + vec2(0.0, texelSize.y)) +
+                 sampleScene(uv - vec2(0.0, texelSize.y))) * 0.25;
+    vec3 sharpened = center + (center - blur) * sharpness;
+    FragColor = vec4(clamp(sharpened, 0.0, 1.0), 1.0);
+}
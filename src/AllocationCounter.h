@@ -0,0 +1,64 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+// Debug counter for global operator new. Used to check that steady-state
+// frames don't touch the heap. Replaces the global allocation functions, so
+// include it from exactly one translation unit (main.cpp).
+//
+// Only allocations made through operator new are counted; ImGui, GLFW and
+// the GL driver allocate with malloc and are not included.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace AllocationCounter {
+    inline std::atomic<uint64_t>& total() {
+        static std::atomic<uint64_t> count{0};
+        return count;
+    }
+
+    inline bool enabled() {
+#ifdef ENGINE_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+}
+
+#ifdef ENGINE_TRACK_ALLOCATIONS
+
+void* operator new(std::size_t size) {
+    AllocationCounter::total().fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    if (void* ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+#endif
+
+#endif
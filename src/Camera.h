@@ -42,6 +42,12 @@ public:
         updateCameraVectors();
     }
 
+    void SetOrientation(float yaw, float pitch) {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
 private:
     void updateCameraVectors() {
         glm::vec3 front;
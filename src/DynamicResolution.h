@@ -0,0 +1,47 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <cmath>
+
+// Picks the render scale for the lit pass from measured GPU frame times.
+//
+// Shading cost grows with pixel count, i.e. with scale^2, so the scale that
+// would hit the budget is scale * sqrt(target / measured). The controller
+// moves part of the way there each update and only reacts outside a
+// hysteresis band, so the resolution doesn't oscillate frame to frame.
+class DynamicResolution {
+public:
+    float scale = 1.0f;
+
+    // Don't let the shadow map drop below this fraction of its full size
+    float minShadowScale = 0.5f;
+
+    float shadowScale() const {
+        return scale > minShadowScale ? scale : minShadowScale;
+    }
+
+    void update(float gpuMs, float targetMs, float minScale) {
+        if (gpuMs <= 0.0f || targetMs <= 0.0f)
+            return;
+        smoothedMs = smoothedMs > 0.0f ? smoothedMs * 0.8f + gpuMs * 0.2f : gpuMs;
+
+        // Over budget: shrink. Well under budget: grow back towards native.
+        if (smoothedMs > targetMs || smoothedMs < targetMs * 0.85f) {
+            float desired = scale * std::sqrt(targetMs * 0.92f / smoothedMs);
+            scale += (desired - scale) * 0.25f;
+        }
+
+        if (scale < minScale) scale = minScale;
+        if (scale > 1.0f) scale = 1.0f;
+    }
+
+    void reset() {
+        scale = 1.0f;
+        smoothedMs = 0.0f;
+    }
+
+private:
+    float smoothedMs = 0.0f;
+};
+
+#endif
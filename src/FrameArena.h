@@ -0,0 +1,139 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Bump allocator for data that lives for a single frame. Allocation is a
+// pointer increment, individual frees are no-ops and reset() releases
+// everything at once.
+//
+// If a frame needs more than the current capacity the extra requests are
+// served from overflow blocks, and the next reset() grows the main block to
+// the observed peak. After a warm-up frame or two the arena stops touching
+// the heap entirely.
+class LinearArena {
+public:
+    explicit LinearArena(size_t capacity = 64 * 1024) {
+        reserve(capacity);
+    }
+
+    ~LinearArena() {
+        freeOverflow();
+        ::operator delete(base);
+    }
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment) {
+        size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+        if (aligned + size <= capacityBytes) {
+            offset = aligned + size;
+            return base + aligned;
+        }
+        return allocateOverflow(size, alignment);
+    }
+
+    // Release everything allocated since the last reset
+    void reset() {
+        size_t peak = offset + overflowBytes;
+        freeOverflow();
+        if (peak > capacityBytes)
+            reserve(peak + peak / 2);
+        offset = 0;
+    }
+
+    size_t used() const { return offset + overflowBytes; }
+    size_t capacity() const { return capacityBytes; }
+
+private:
+    struct OverflowBlock {
+        OverflowBlock* next;
+    };
+
+    char* base = nullptr;
+    size_t capacityBytes = 0;
+    size_t offset = 0;
+    OverflowBlock* overflow = nullptr;
+    size_t overflowBytes = 0;
+
+    void reserve(size_t capacity) {
+        ::operator delete(base);
+        base = (char*)::operator new(capacity);
+        capacityBytes = capacity;
+    }
+
+    void* allocateOverflow(size_t size, size_t alignment) {
+        size_t header = (sizeof(OverflowBlock) + alignment - 1) & ~(alignment - 1);
+        char* block = (char*)::operator new(header + size);
+        OverflowBlock* node = (OverflowBlock*)block;
+        node->next = overflow;
+        overflow = node;
+        overflowBytes += size;
+        return block + header;
+    }
+
+    void freeOverflow() {
+        while (overflow) {
+            OverflowBlock* next = overflow->next;
+            ::operator delete(overflow);
+            overflow = next;
+        }
+        overflowBytes = 0;
+    }
+};
+
+// Two arenas used on alternate frames. Data allocated in frame N stays valid
+// through frame N+1, so results can be compared against the previous frame.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = 64 * 1024)
+        : arenas{ LinearArena(capacity), LinearArena(capacity) } {}
+
+    // Switch to the other arena and reset it
+    void beginFrame() {
+        current ^= 1;
+        arenas[current].reset();
+    }
+
+    LinearArena& get() { return arenas[current]; }
+    LinearArena& previous() { return arenas[current ^ 1]; }
+
+private:
+    LinearArena arenas[2];
+    int current = 0;
+};
+
+// std-compatible allocator drawing from a LinearArena; deallocate is a no-op
+template <typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    LinearArena* arena;
+
+    explicit ArenaAllocator(LinearArena* arena) : arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return (T*)arena->allocate(n * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+// Vector whose storage lives in a frame arena. Must not outlive the arena's
+// next reset; create a fresh one each frame rather than clear()ing an old one.
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
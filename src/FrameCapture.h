@@ -0,0 +1,376 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ImageWriter.h"
+
+// File format of a captured image; CAPTURE_OFF skips it
+enum CaptureFormat {
+    CAPTURE_OFF = 0,
+    CAPTURE_PNG = 1,  // color only
+    CAPTURE_EXR = 2,  // shadow depth only
+    CAPTURE_RAW = 3,
+};
+
+// What to read back from the frame that was just rendered
+struct CaptureRequest {
+    unsigned int frameIndex = 0;
+    int colorFormat = CAPTURE_OFF;  // default framebuffer's back buffer
+    int width = 0;
+    int height = 0;
+    int depthFormat = CAPTURE_OFF;  // depth attachment of depthFramebuffer
+    unsigned int depthFramebuffer = 0;
+    int depthWidth = 0;
+    int depthHeight = 0;
+    bool wait = false;  // wait for a free slot instead of dropping the capture
+};
+
+// Asynchronous readback of rendered frames to image files (render thread).
+//
+// capture() only queues glReadPixels into a free slot's pixel buffer objects
+// and fences it; no pixel crosses the bus before the GPU gets there.
+// update() polls the fences of earlier captures without waiting and hands
+// the finished slots to encoder threads, which read straight from the
+// mapped buffers, so the render thread never copies pixels. A slot is
+// reused once its files are written.
+//
+// With ARB_buffer_storage the buffers are mapped once, persistently and
+// coherently; otherwise a slot is mapped when its fence signals and unmapped
+// after encoding. When every slot is busy the capture is dropped, unless the
+// request asks to wait: then capture() runs the ring until a slot is free,
+// stalling the render thread (and through the snapshot queue the UI thread)
+// for as long as the encoders are behind.
+class FrameCapture {
+public:
+    static const int SLOTS = 8;
+
+    // Counters for the UI, written by the render and encoder threads
+    std::atomic<unsigned int> written{0};  // captures with all files written
+    std::atomic<unsigned int> dropped{0};  // captures skipped, ring full
+    std::atomic<unsigned int> waited{0};   // captures that had to wait for a slot
+    std::atomic<unsigned int> failed{0};   // files that could not be written
+    float lastMs = 0.0f;  // render thread time in update() + capture(), last frame
+
+    FrameCapture(const char* directory, int encoderThreads) : directory(directory) {
+#ifdef GL_MAP_PERSISTENT_BIT
+        persistent = glBufferStorage != NULL;
+#endif
+        for (int i = 0; i < encoderThreads; i++)
+            encoders.emplace_back(&FrameCapture::encoderMain, this);
+    }
+
+    // Writes out captures still in flight. Needs the GL context.
+    ~FrameCapture() {
+        finish();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : encoders)
+            thread.join();
+        for (Slot& slot : slots) {
+            releaseBuffer(slot.color);
+            releaseBuffer(slot.depth);
+        }
+    }
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    const std::string& outputDirectory() const { return directory; }
+
+    // Slots waiting for the GPU or an encoder
+    int busySlots() const {
+        int busy = 0;
+        for (const Slot& slot : slots)
+            busy += slot.state.load(std::memory_order_relaxed) != FREE;
+        return busy;
+    }
+
+    // Once per frame, before capture()
+    void update() {
+        Clock::time_point start = Clock::now();
+        for (Slot& slot : slots) {
+            int state = slot.state.load(std::memory_order_acquire);
+            if (state == READBACK)
+                pollReadback(slot, 0);
+            else if (state == ENCODED)
+                recycle(slot);
+        }
+        lastMs = millisecondsSince(start);
+    }
+
+    // Queue readbacks of the current frame. Returns false if it was dropped.
+    bool capture(const CaptureRequest& request) {
+        Clock::time_point start = Clock::now();
+        bool queued = queueReadback(request);
+        lastMs += millisecondsSince(start);
+        return queued;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    enum SlotState { FREE, READBACK, ENCODING, ENCODED };
+
+    struct PixelBuffer {
+        unsigned int ID = 0;
+        GLsizeiptr capacity = 0;
+        void* persistentData = nullptr;
+        const void* data = nullptr;  // mapped while encoding
+        int format = CAPTURE_OFF;
+        int width = 0;
+        int height = 0;
+    };
+
+    struct Slot {
+        unsigned int frameIndex = 0;
+        PixelBuffer color;
+        PixelBuffer depth;
+        GLsync fence = 0;
+        std::atomic<int> state{FREE};
+    };
+
+    std::string directory;
+    bool directoryReady = false;
+    bool persistent = false;
+    Slot slots[SLOTS];
+    int nextSlot = 0;
+
+    std::vector<std::thread> encoders;
+    std::mutex mutex;
+    std::condition_variable wake;
+    int queue[SLOTS];  // slots ready to encode, FIFO
+    int queueHead = 0;
+    int queueSize = 0;
+    bool stopping = false;
+
+    static float millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+
+    bool queueReadback(const CaptureRequest& request) {
+        if (request.colorFormat == CAPTURE_OFF && request.depthFormat == CAPTURE_OFF)
+            return true;
+        Slot* slot = nullptr;
+        for (int i = 0; i < SLOTS && slot == nullptr; i++) {
+            Slot& candidate = slots[(nextSlot + i) % SLOTS];
+            if (candidate.state.load(std::memory_order_acquire) == FREE) {
+                slot = &candidate;
+                nextSlot = (nextSlot + i + 1) % SLOTS;
+            }
+        }
+        if (slot == nullptr && request.wait) {
+            waited.fetch_add(1, std::memory_order_relaxed);
+            slot = waitForSlot();
+        }
+        if (slot == nullptr) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!directoryReady) {
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+            directoryReady = true;
+        }
+
+        slot->frameIndex = request.frameIndex;
+        if (request.colorFormat != CAPTURE_OFF)
+            readPixels(slot->color, 0, request.width, request.height, GL_RGBA, GL_UNSIGNED_BYTE, 4);
+        if (request.depthFormat != CAPTURE_OFF) {
+            readPixels(slot->depth, request.depthFramebuffer, request.depthWidth, request.depthHeight,
+                       GL_DEPTH_COMPONENT, GL_FLOAT, sizeof(float));
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        slot->color.format = request.colorFormat;
+        slot->depth.format = request.depthFormat;
+
+        slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot->state.store(READBACK, std::memory_order_release);
+        return true;
+    }
+
+    void readPixels(PixelBuffer& buffer, unsigned int framebuffer, int width, int height,
+                    GLenum format, GLenum type, int bytesPerPixel) {
+        reserveBuffer(buffer, (GLsizeiptr)width * height * bytesPerPixel);
+        buffer.width = width;
+        buffer.height = height;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        if (framebuffer == 0)
+            glReadBuffer(GL_BACK);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.ID);
+        glReadPixels(0, 0, width, height, format, type, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // Grow a slot's buffer to hold size bytes; reallocates only on resize
+    void reserveBuffer(PixelBuffer& buffer, GLsizeiptr size) {
+        if (buffer.capacity >= size)
+            return;
+        releaseBuffer(buffer);
+        glGenBuffers(1, &buffer.ID);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.ID);
+#ifdef GL_MAP_PERSISTENT_BIT
+        if (persistent) {
+            GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_PACK_BUFFER, size, NULL, flags | GL_CLIENT_STORAGE_BIT);
+            buffer.persistentData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags);
+        }
+#endif
+        if (!persistent)
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        buffer.capacity = size;
+    }
+
+    void releaseBuffer(PixelBuffer& buffer) {
+        if (buffer.ID == 0)
+            return;
+        if (buffer.persistentData != nullptr) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.ID);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer.ID);
+        buffer = PixelBuffer();
+    }
+
+    // Hand the slot to an encoder once the GPU has written its buffers
+    void pollReadback(Slot& slot, GLuint64 timeout) {
+        GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            return;
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+        mapBuffer(slot.color);
+        mapBuffer(slot.depth);
+
+        slot.state.store(ENCODING, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue[(queueHead + queueSize) % SLOTS] = (int)(&slot - slots);
+            queueSize++;
+        }
+        wake.notify_one();
+    }
+
+    void mapBuffer(PixelBuffer& buffer) {
+        if (buffer.format == CAPTURE_OFF)
+            return;
+        if (buffer.persistentData != nullptr) {
+            buffer.data = buffer.persistentData;
+            return;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.ID);
+        buffer.data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer.capacity, GL_MAP_READ_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    void unmapBuffer(PixelBuffer& buffer) {
+        if (buffer.data != nullptr && buffer.persistentData == nullptr) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.ID);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        buffer.data = nullptr;
+    }
+
+    void recycle(Slot& slot) {
+        unmapBuffer(slot.color);
+        unmapBuffer(slot.depth);
+        slot.state.store(FREE, std::memory_order_release);
+    }
+
+    // Block until a slot is free, polling fences and recycling encoded slots
+    Slot* waitForSlot() {
+        while (true) {
+            for (Slot& slot : slots) {
+                int state = slot.state.load(std::memory_order_acquire);
+                if (state == READBACK)
+                    pollReadback(slot, 0);
+                else if (state == ENCODED)
+                    recycle(slot);
+                if (slot.state.load(std::memory_order_acquire) == FREE)
+                    return &slot;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // Block until every capture in flight is written (shutdown only)
+    void finish() {
+        while (busySlots() > 0) {
+            for (Slot& slot : slots) {
+                int state = slot.state.load(std::memory_order_acquire);
+                if (state == READBACK)
+                    pollReadback(slot, 1000000000);
+                else if (state == ENCODED)
+                    recycle(slot);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void encoderMain() {
+        ImageScratch scratch;
+        while (true) {
+            int index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || queueSize > 0; });
+                if (queueSize == 0)
+                    return;  // stopping
+                index = queue[queueHead];
+                queueHead = (queueHead + 1) % SLOTS;
+                queueSize--;
+            }
+            Slot& slot = slots[index];
+            bool ok = encode(slot.frameIndex, "frame", "rgba8", slot.color, scratch);
+            ok = encode(slot.frameIndex, "depth", "f32", slot.depth, scratch) && ok;
+            if (ok)
+                written.fetch_add(1, std::memory_order_relaxed);
+            slot.state.store(ENCODED, std::memory_order_release);
+        }
+    }
+
+    // Raw files are 4 bytes per pixel (RGBA8 color or float depth), top row
+    // first, with the size in the name
+    bool encode(unsigned int frameIndex, const char* name, const char* rawExtension,
+                const PixelBuffer& buffer, ImageScratch& scratch) {
+        if (buffer.format == CAPTURE_OFF)
+            return true;
+        char path[512];
+        bool ok = false;
+        if (buffer.data == nullptr) {
+            std::snprintf(path, sizeof(path), "%s/%s_%06u", directory.c_str(), name, frameIndex);
+        } else if (buffer.format == CAPTURE_PNG) {
+            std::snprintf(path, sizeof(path), "%s/%s_%06u.png", directory.c_str(), name, frameIndex);
+            ok = writePng(path, (const uint8_t*)buffer.data, buffer.width, buffer.height, scratch);
+        } else if (buffer.format == CAPTURE_EXR) {
+            std::snprintf(path, sizeof(path), "%s/%s_%06u.exr", directory.c_str(), name, frameIndex);
+            ok = writeExrDepth(path, (const float*)buffer.data, buffer.width, buffer.height, scratch);
+        } else {
+            std::snprintf(path, sizeof(path), "%s/%s_%06u_%dx%d.%s", directory.c_str(), name, frameIndex,
+                          buffer.width, buffer.height, rawExtension);
+            ok = writeRaw(path, buffer.data, (size_t)buffer.width * 4, buffer.height, scratch);
+        }
+        if (!ok) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            std::cout << "FrameCapture: could not write " << path << "\n";
+        }
+        return ok;
+    }
+};
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+#include <glm/glm.hpp>
+#include <imgui.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include "FrameArena.h"
+
+// Number of snapshot slots shared by the UI and render threads.
+// 2 = double buffering (UI builds frame N+1 while frame N is submitted),
+// 3 = triple buffering (UI may run one more frame ahead).
+const int SNAPSHOT_SLOTS = 2;
+
+enum MeshType { MESH_PLANE = 0, MESH_CUBE = 1 };
+
+struct ObjectSnapshot {
+    glm::mat4 model;
+    glm::vec3 color;
+    MeshType mesh;
+};
+
+typedef FrameVector<ObjectSnapshot> DrawList;
+
+// Camera views of the multi-view pass; must match MAX_VIEWS in shadow.vert
+const int MAX_VIEWS = 16;
+
+// Immutable description of one frame. The UI thread fills it in, the render
+// thread only reads it, so no scene global is ever touched from two threads.
+// The one exception is ImGui's texture list (1.92+), which the render thread
+// updates only while the UI thread waits in waitForTextureUpdates().
+//
+// Variable-sized data (the draw list) lives in the slot's own arena. A slot is
+// only rewritten after the render thread released it, so the slot ring doubles
+// as the arena's double buffer.
+struct FrameSnapshot {
+    unsigned int frameIndex = 0;
+    int width = 0;
+    int height = 0;
+
+    // Camera
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::mat4 viewProjection;
+    glm::vec3 viewPos;
+
+    // Light
+    glm::mat4 lightSpaceMatrix;
+    glm::vec3 lightPos;
+    int lightType = 0;
+    float lightConstant = 1.0f;
+    float lightLinear = 0.0f;
+    float lightQuadratic = 0.0f;
+    float lightNear = 1.0f;
+    float lightFar = 25.0f;
+
+    // Lighting and render settings
+    float ambientStrength = 0.0f;
+    float specularStrength = 0.0f;
+    int shininess = 32;
+    float shadowBias = 0.0f;
+    bool enableShadows = true;
+    glm::vec3 clearColor;
+    bool wireframe = false;
+    int renderMode = 0;
+    bool showShadowMapOverlay = false;
+    float overlaySize = 0.25f;
+    bool depthPrepass = false;
+    bool occlusionCulling = false;
+    int captureColor = 0;  // CaptureFormat of this frame's readbacks, 0 = off
+    int captureDepth = 0;
+    bool captureWait = false;  // stall rather than drop the capture (replays)
+
+    // Extra camera views rendered into tiles of the multi-view target
+    int viewCount = 0;
+    glm::mat4 viewProjections[MAX_VIEWS];
+    glm::vec3 viewPositions[MAX_VIEWS];
+    bool dynamicResolution = false;
+    float targetFrameMs = 16.6f;
+    float minResolutionScale = 0.5f;
+    float upscaleSharpness = 0.0f;
+    bool reloadShaders = false;
+
+    // Transient per-frame storage, and the scene objects in draw order
+    LinearArena arena;
+    DrawList objects;
+
+    // Copy of ImGui's draw data for this frame
+    ImDrawData uiDrawData;
+    // Some ImGui texture wants creating, updating or destroying. The live
+    // texture list is then handed over through SnapshotQueue's texture handoff
+    // instead of with the draw data.
+    bool uiTextureUpdates = false;
+#if IMGUI_VERSION_NUM >= 19200
+    ImVector<ImTextureData*>* uiTextures = nullptr;
+#endif
+
+    FrameSnapshot() : objects(ArenaAllocator<ObjectSnapshot>(&arena)) {}
+    FrameSnapshot(const FrameSnapshot&) = delete;
+    FrameSnapshot& operator=(const FrameSnapshot&) = delete;
+
+    ~FrameSnapshot() {
+        for (int i = 0; i < uiListPool.Size; i++)
+            IM_DELETE(uiListPool[i]);
+    }
+
+    // Drop last use's arena data before the slot is refilled
+    void beginFrame(size_t expectedObjects) {
+        objects = DrawList(ArenaAllocator<ObjectSnapshot>(&arena));
+        arena.reset();
+        objects.reserve(expectedObjects);
+    }
+
+    void addObject(MeshType mesh, const glm::mat4& model, const glm::vec3& color) {
+        ObjectSnapshot object;
+        object.model = model;
+        object.color = color;
+        object.mesh = mesh;
+        objects.push_back(object);
+    }
+
+    // Deep-copy ImGui's draw data. ImGui reuses its draw lists on the next
+    // NewFrame(), so the render thread can't read them in place. The draw
+    // lists are pooled per slot and only grow, so steady state is a memcpy.
+    void captureUI(const ImDrawData* src) {
+        uiDrawData.Valid = src->Valid;
+        uiDrawData.CmdListsCount = src->CmdListsCount;
+        uiDrawData.TotalIdxCount = src->TotalIdxCount;
+        uiDrawData.TotalVtxCount = src->TotalVtxCount;
+        uiDrawData.DisplayPos = src->DisplayPos;
+        uiDrawData.DisplaySize = src->DisplaySize;
+        uiDrawData.FramebufferScale = src->FramebufferScale;
+        uiDrawData.OwnerViewport = nullptr;
+#if IMGUI_VERSION_NUM >= 19200
+        // The backend would otherwise process src->Textures inside
+        // RenderDrawData(), racing with the UI thread's next NewFrame().
+        uiDrawData.Textures = nullptr;
+        uiTextures = src->Textures;
+        uiTextureUpdates = false;
+        if (src->Textures != nullptr)
+            for (ImTextureData* tex : *src->Textures)
+                if (tex->Status != ImTextureStatus_OK)
+                    uiTextureUpdates = true;
+#endif
+        while (uiListPool.Size < src->CmdListsCount)
+            uiListPool.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+
+        uiDrawData.CmdLists.resize(src->CmdListsCount);
+        for (int i = 0; i < src->CmdListsCount; i++) {
+            const ImDrawList* in = src->CmdLists[i];
+            ImDrawList* out = uiListPool[i];
+            copyVector(out->CmdBuffer, in->CmdBuffer);
+            copyVector(out->IdxBuffer, in->IdxBuffer);
+            copyVector(out->VtxBuffer, in->VtxBuffer);
+            out->Flags = in->Flags;
+            uiDrawData.CmdLists[i] = out;
+        }
+    }
+
+private:
+    ImVector<ImDrawList*> uiListPool;
+
+    // ImVector::operator= frees and reallocates; resize() keeps capacity.
+    template <typename T>
+    static void copyVector(ImVector<T>& dst, const ImVector<T>& src) {
+        dst.resize(src.Size);
+        if (src.Size > 0)
+            memcpy(dst.Data, src.Data, (size_t)src.Size * sizeof(T));
+    }
+};
+
+// Fixed ring of snapshots handed from the UI thread to the render thread in
+// FIFO order. The writer blocks when every slot is still queued or being
+// rendered; the reader blocks until a snapshot has been published.
+//
+// A snapshot with uiTextureUpdates set is also a texture handoff: after
+// endWrite() the UI thread blocks in waitForTextureUpdates() until the render
+// thread has applied the updates and called texturesUpdated(). ImGui's texture
+// status and TexID writes are then ordered by the queue's mutex.
+class SnapshotQueue {
+public:
+    // Returns the next free slot, or nullptr once shutdown() was called.
+    FrameSnapshot* beginWrite() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return closed || inFlight < SNAPSHOT_SLOTS; });
+        if (closed)
+            return nullptr;
+        return &slots[writeIndex];
+    }
+
+    void endWrite() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            texturesPending = slots[writeIndex].uiTextureUpdates;
+            writeIndex = (writeIndex + 1) % SNAPSHOT_SLOTS;
+            inFlight++;
+        }
+        cond.notify_all();
+    }
+
+    // UI thread, after endWrite(): returns once the published snapshot's
+    // texture updates were applied. Immediate when it had none.
+    void waitForTextureUpdates() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return closed || !texturesPending; });
+    }
+
+    // Render thread: the current snapshot's texture updates are done
+    void texturesUpdated() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            texturesPending = false;
+        }
+        cond.notify_all();
+    }
+
+    // Returns the oldest published snapshot, or nullptr once shutdown() was called.
+    FrameSnapshot* beginRead() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return closed || inFlight > 0; });
+        if (closed)
+            return nullptr;
+        return &slots[readIndex];
+    }
+
+    // Hands the slot back to the writer. Call once the GL commands that read
+    // the snapshot have been issued.
+    void endRead() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readIndex = (readIndex + 1) % SNAPSHOT_SLOTS;
+            inFlight--;
+        }
+        cond.notify_all();
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        cond.notify_all();
+    }
+
+private:
+    FrameSnapshot slots[SNAPSHOT_SLOTS];
+    int writeIndex = 0;
+    int readIndex = 0;
+    int inFlight = 0;  // published and not yet released by the reader
+    bool texturesPending = false;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable cond;
+};
+
+// Smoothed per-thread timings used to show how much CPU frame building
+// overlaps with GL submission. Each field has a single writer thread.
+struct ThreadTimings {
+    std::atomic<float> buildMs{0.0f};       // UI thread: input + ImGui + snapshot
+    std::atomic<float> buildWaitMs{0.0f};   // UI thread: blocked on a free slot
+    std::atomic<float> submitMs{0.0f};      // render thread: GL submission + swap
+    std::atomic<float> submitWaitMs{0.0f};  // render thread: blocked on a snapshot
+    std::atomic<float> frameMs{0.0f};       // render thread: swap-to-swap interval
+
+    static void accumulate(std::atomic<float>& average, float sample) {
+        float previous = average.load(std::memory_order_relaxed);
+        average.store(previous * 0.95f + sample * 0.05f, std::memory_order_relaxed);
+    }
+
+    // Time per frame during which both threads were busy. Run serially a
+    // frame costs build + submit; fully pipelined it costs max(build, submit).
+    float overlapMs() const {
+        float build = buildMs.load(std::memory_order_relaxed);
+        float submit = submitMs.load(std::memory_order_relaxed);
+        float overlap = build + submit - frameMs.load(std::memory_order_relaxed);
+        float limit = build < submit ? build : submit;
+        if (overlap < 0.0f) overlap = 0.0f;
+        if (overlap > limit) overlap = limit;
+        return overlap;
+    }
+
+    // Achieved overlap as a fraction of the best possible overlap.
+    float overlapRatio() const {
+        float build = buildMs.load(std::memory_order_relaxed);
+        float submit = submitMs.load(std::memory_order_relaxed);
+        float limit = build < submit ? build : submit;
+        return limit > 0.0f ? overlapMs() / limit : 0.0f;
+    }
+};
+
+// Counters published by the render thread for display in the UI
+struct RenderStats {
+    std::atomic<unsigned int> uploadBytes{0};     // streamed uniform data, last frame
+    std::atomic<unsigned int> fenceWaits{0};      // frames that blocked on a ring fence
+    std::atomic<float> fenceWaitMs{0.0f};         // time blocked on the fence, last frame
+    std::atomic<bool> persistentMapping{false};   // ARB_buffer_storage path active
+    std::atomic<unsigned int> arenaBytes{0};      // render thread frame arena in use
+    std::atomic<float> gpuFrameMs{0.0f};          // GPU time of the last measured frame
+    std::atomic<float> multiViewMs{0.0f};         // GPU time of the last measured multi-view pass
+    std::atomic<int> multiViewViews{0};           // views drawn in that pass
+    std::atomic<uint64_t> litSamples{0};          // samples passed in the lit pass
+    std::atomic<int> litVariants{0};              // lit shader permutations compiled
+    std::atomic<float> resolutionScale{1.0f};     // lit pass render scale
+    std::atomic<float> shadowMapScale{1.0f};      // fraction of the shadow map in use
+    std::atomic<int> occlusionCulled{0};          // objects dropped from the lit pass
+    std::atomic<int> occlusionTriangles{0};       // occluder triangles rasterized on the CPU
+    std::atomic<float> occlusionMs{0.0f};         // CPU time of setup + raster + test
+    std::atomic<float> captureMs{0.0f};           // render thread time spent on captures, last frame
+    std::atomic<int> captureBusySlots{0};         // readbacks waiting for the GPU or an encoder
+    std::atomic<unsigned int> capturesWritten{0}; // captured frames written to disk
+    std::atomic<unsigned int> capturesDropped{0}; // captures skipped because the ring was full
+    std::atomic<unsigned int> capturesWaited{0};  // captures that stalled for a free slot
+    std::atomic<unsigned int> captureFailures{0}; // capture files that could not be written
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// Frames a query result may lag behind before begin() has to wait for it
+const int GPU_QUERY_LATENCY = 4;
+
+// Query object that never stalls the pipeline: each frame uses the next
+// query in a small ring, and poll() picks up results as they become
+// available a few frames later. Queries of the same target must not overlap.
+class GpuQueryRing {
+public:
+    GLuint64 lastResult = 0;  // most recent completed result
+
+    explicit GpuQueryRing(GLenum target) : target(target) {
+        glGenQueries(GPU_QUERY_LATENCY, queries);
+    }
+
+    ~GpuQueryRing() {
+        glDeleteQueries(GPU_QUERY_LATENCY, queries);
+    }
+
+    GpuQueryRing(const GpuQueryRing&) = delete;
+    GpuQueryRing& operator=(const GpuQueryRing&) = delete;
+
+    void begin() {
+        if (pending[next])
+            readResult(next);  // blocks only if the GPU is LATENCY frames behind
+        glBeginQuery(target, queries[next]);
+    }
+
+    void end() {
+        glEndQuery(target);
+        pending[next] = true;
+        next = (next + 1) % GPU_QUERY_LATENCY;
+    }
+
+    // Collect finished results, oldest first. Returns true if lastResult changed.
+    bool poll() {
+        bool updated = false;
+        for (int i = 0; i < GPU_QUERY_LATENCY; i++) {
+            int slot = (next + i) % GPU_QUERY_LATENCY;
+            if (!pending[slot])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            readResult(slot);
+            updated = true;
+        }
+        return updated;
+    }
+
+private:
+    GLenum target;
+    unsigned int queries[GPU_QUERY_LATENCY];
+    bool pending[GPU_QUERY_LATENCY] = {};
+    int next = 0;
+
+    void readResult(int slot) {
+        glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &lastResult);
+        pending[slot] = false;
+    }
+};
+
+// GL_TIME_ELAPSED in milliseconds
+class GpuTimer : public GpuQueryRing {
+public:
+    GpuTimer() : GpuQueryRing(GL_TIME_ELAPSED) {}
+
+    float lastMs() const { return lastResult / 1000000.0f; }
+};
+
+// GPU time between two GL_TIMESTAMP counters, in milliseconds. Unlike
+// GpuTimer it can measure one pass inside a frame that GpuTimer is timing,
+// since timestamps are not queries that have to be begun and ended.
+class GpuSpanTimer {
+public:
+    GpuSpanTimer() {
+        glGenQueries(2 * GPU_QUERY_LATENCY, queries);
+    }
+
+    ~GpuSpanTimer() {
+        glDeleteQueries(2 * GPU_QUERY_LATENCY, queries);
+    }
+
+    GpuSpanTimer(const GpuSpanTimer&) = delete;
+    GpuSpanTimer& operator=(const GpuSpanTimer&) = delete;
+
+    void begin() {
+        if (pending[next])
+            readResult(next);  // blocks only if the GPU is LATENCY spans behind
+        glQueryCounter(queries[2 * next], GL_TIMESTAMP);
+    }
+
+    void end() {
+        glQueryCounter(queries[2 * next + 1], GL_TIMESTAMP);
+        pending[next] = true;
+        next = (next + 1) % GPU_QUERY_LATENCY;
+    }
+
+    // Collect finished spans, oldest first. Returns true if lastMs() changed.
+    bool poll() {
+        bool updated = false;
+        for (int i = 0; i < GPU_QUERY_LATENCY; i++) {
+            int slot = (next + i) % GPU_QUERY_LATENCY;
+            if (!pending[slot])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[2 * slot + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            readResult(slot);
+            updated = true;
+        }
+        return updated;
+    }
+
+    float lastMs() const { return lastNs / 1000000.0f; }
+
+private:
+    unsigned int queries[2 * GPU_QUERY_LATENCY];  // start and end per slot
+    bool pending[GPU_QUERY_LATENCY] = {};
+    int next = 0;
+    GLuint64 lastNs = 0;
+
+    void readResult(int slot) {
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(queries[2 * slot], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[2 * slot + 1], GL_QUERY_RESULT, &end);
+        lastNs = end - start;
+        pending[slot] = false;
+    }
+};
+
+#endif
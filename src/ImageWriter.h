@@ -0,0 +1,360 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Image file encoders for frame captures. Input rows are in GL order (bottom
+// row first, as glReadPixels returns them) and are written top row first.
+//
+// There is no zlib in the tree, so PNG data is compressed with a small
+// built-in deflate: greedy LZ77 over a 32 KB window with one hash candidate
+// per position, coded with the fixed Huffman tables. It gets most of zlib's
+// fast-level ratio on rendered frames at a fraction of the code.
+//
+// Scratch buffers only grow, so an encoder thread that keeps its scratch
+// between images stops allocating after the first one.
+struct ImageScratch {
+    std::vector<uint8_t> rows;    // filtered PNG scanlines
+    std::vector<uint8_t> output;  // encoded file contents
+    std::vector<int32_t> hashHead;
+};
+
+namespace image_writer {
+
+// stdio rather than fstream: no operator new per file
+inline bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* file = std::fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+inline void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+// Little-endian hosts only, like the GL readback data itself
+template <typename T>
+void putNative(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = (const uint8_t*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+inline void putString(std::vector<uint8_t>& out, const char* text) {
+    out.insert(out.end(), text, text + std::strlen(text) + 1);
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[i] = c;
+            }
+        }
+    } table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        size_t block = std::min<size_t>(size, 5552);  // largest run without overflow
+        size -= block;
+        for (size_t i = 0; i < block; i++) {
+            a += data[i];
+            b += a;
+        }
+        data += block;
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// Deflate bit stream: values LSB first, Huffman codes MSB first
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    void put(uint32_t value, int count) {
+        bits |= (uint64_t)value << used;
+        used += count;
+        while (used >= 8) {
+            out.push_back((uint8_t)bits);
+            bits >>= 8;
+            used -= 8;
+        }
+    }
+
+    void putCode(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++)
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        put(reversed, length);
+    }
+
+    void flush() {
+        if (used > 0)
+            out.push_back((uint8_t)bits);
+        bits = 0;
+        used = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t bits = 0;
+    int used = 0;
+};
+
+// Fixed Huffman literal/length code (RFC 1951, 3.2.6)
+inline void putSymbol(BitWriter& writer, int symbol) {
+    if (symbol < 144)
+        writer.putCode(0x30 + symbol, 8);
+    else if (symbol < 256)
+        writer.putCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        writer.putCode(symbol - 256, 7);
+    else
+        writer.putCode(0xC0 + symbol - 280, 8);
+}
+
+inline int floorLog2(uint32_t value) {
+    int log = 0;
+    while (value >>= 1)
+        log++;
+    return log;
+}
+
+inline void putMatch(BitWriter& writer, int length, int distance) {
+    // Length 3..258: codes 257..285, from 265 on with (log2 - 2) extra bits
+    int l = length - 3;
+    if (length == 258) {
+        putSymbol(writer, 285);
+    } else if (l < 8) {
+        putSymbol(writer, 257 + l);
+    } else {
+        int n = floorLog2((uint32_t)l);
+        int low = (l >> (n - 2)) & 3;
+        putSymbol(writer, 257 + 4 * (n - 1) + low);
+        writer.put((uint32_t)(l - ((4 | low) << (n - 2))), n - 2);
+    }
+
+    // Distance 1..32768: codes 0..29, from 4 on with (log2 - 1) extra bits
+    int d = distance - 1;
+    if (d < 4) {
+        writer.putCode((uint32_t)d, 5);
+    } else {
+        int n = floorLog2((uint32_t)d);
+        int low = (d >> (n - 1)) & 1;
+        writer.putCode((uint32_t)(2 * n + low), 5);
+        writer.put((uint32_t)(d - ((2 | low) << (n - 1))), n - 1);
+    }
+}
+
+// zlib stream of data (one fixed-Huffman deflate block) appended to out
+inline void deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, std::vector<int32_t>& hashHead) {
+    const int HASH_BITS = 15;
+    const int WINDOW = 32768;
+    const int MAX_MATCH = 258;
+
+    out.push_back(0x78);  // 32 KB window, deflate
+    out.push_back(0x01);  // fastest level, header checksum
+    BitWriter writer(out);
+    writer.put(1, 1);  // final block
+    writer.put(1, 2);  // fixed Huffman codes
+
+    hashHead.assign((size_t)1 << HASH_BITS, -1);
+    auto hash = [data](size_t i) {
+        uint32_t value = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    };
+
+    size_t i = 0;
+    while (i < size) {
+        if (i + 3 <= size) {
+            uint32_t h = hash(i);
+            int32_t candidate = hashHead[h];
+            hashHead[h] = (int32_t)i;
+            if (candidate >= 0 && i - candidate <= (size_t)WINDOW &&
+                std::memcmp(data + candidate, data + i, 3) == 0) {
+                size_t limit = std::min<size_t>(MAX_MATCH, size - i);
+                size_t length = 3;
+                while (length < limit && data[candidate + length] == data[i + length])
+                    length++;
+                putMatch(writer, (int)length, (int)(i - candidate));
+                for (size_t j = i + 1; j < i + length && j + 3 <= size; j++)
+                    hashHead[hash(j)] = (int32_t)j;
+                i += length;
+                continue;
+            }
+        }
+        putSymbol(writer, data[i]);
+        i++;
+    }
+    putSymbol(writer, 256);  // end of block
+    writer.flush();
+    putBigEndian(out, adler32(data, size));
+}
+
+inline void putChunk(std::vector<uint8_t>& out, const char* type, size_t start) {
+    // The chunk's data was appended after an 8-byte length + type placeholder
+    uint32_t length = (uint32_t)(out.size() - start - 8);
+    uint8_t* header = out.data() + start;
+    header[0] = (uint8_t)(length >> 24);
+    header[1] = (uint8_t)(length >> 16);
+    header[2] = (uint8_t)(length >> 8);
+    header[3] = (uint8_t)length;
+    std::memcpy(header + 4, type, 4);
+    putBigEndian(out, crc32(out.data() + start + 4, length + 4));
+}
+
+inline size_t beginChunk(std::vector<uint8_t>& out) {
+    size_t start = out.size();
+    out.resize(start + 8);
+    return start;
+}
+
+}  // namespace image_writer
+
+// 8-bit RGB PNG from RGBA8 rows (alpha is dropped). Rows are filtered with
+// "up" (the first with "sub"), which suits smooth rendered gradients.
+inline bool writePng(const char* path, const uint8_t* rgba, int width, int height, ImageScratch& scratch) {
+    using namespace image_writer;
+    size_t rowBytes = (size_t)width * 3;
+    scratch.rows.resize((rowBytes + 1) * height);
+    const uint8_t* previous = nullptr;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = rgba + (size_t)(height - 1 - y) * width * 4;
+        uint8_t* dst = scratch.rows.data() + (rowBytes + 1) * y;
+        dst[0] = previous ? 2 : 1;
+        uint8_t* out = dst + 1;
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < 3; c++) {
+                uint8_t value = src[x * 4 + c];
+                uint8_t predictor = previous ? previous[x * 4 + c] : (x > 0 ? src[(x - 1) * 4 + c] : 0);
+                out[x * 3 + c] = (uint8_t)(value - predictor);
+            }
+        }
+        previous = src;
+    }
+
+    std::vector<uint8_t>& out = scratch.output;
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.assign(signature, signature + 8);
+
+    size_t chunk = beginChunk(out);
+    putBigEndian(out, (uint32_t)width);
+    putBigEndian(out, (uint32_t)height);
+    out.push_back(8);  // bit depth
+    out.push_back(2);  // truecolor
+    out.push_back(0);  // deflate
+    out.push_back(0);  // adaptive filtering
+    out.push_back(0);  // no interlace
+    putChunk(out, "IHDR", chunk);
+
+    chunk = beginChunk(out);
+    deflate(scratch.rows.data(), scratch.rows.size(), out, scratch.hashHead);
+    putChunk(out, "IDAT", chunk);
+
+    chunk = beginChunk(out);
+    putChunk(out, "IEND", chunk);
+    return writeFile(path, out);
+}
+
+// Single-channel ("Z") 32-bit float OpenEXR, scanline, uncompressed
+inline bool writeExrDepth(const char* path, const float* depth, int width, int height, ImageScratch& scratch) {
+    using namespace image_writer;
+    std::vector<uint8_t>& out = scratch.output;
+    out.clear();
+    putNative(out, (uint32_t)20000630);  // magic
+    putNative(out, (uint32_t)2);         // version 2, scanline image
+
+    putString(out, "channels");
+    putString(out, "chlist");
+    putNative(out, (int32_t)19);  // one channel + terminator
+    putString(out, "Z");
+    putNative(out, (int32_t)2);  // FLOAT
+    putNative(out, (uint32_t)0); // pLinear + reserved
+    putNative(out, (int32_t)1);  // x sampling
+    putNative(out, (int32_t)1);  // y sampling
+    out.push_back(0);
+
+    putString(out, "compression");
+    putString(out, "compression");
+    putNative(out, (int32_t)1);
+    out.push_back(0);  // NO_COMPRESSION
+
+    const char* windows[2] = { "dataWindow", "displayWindow" };
+    for (const char* window : windows) {
+        putString(out, window);
+        putString(out, "box2i");
+        putNative(out, (int32_t)16);
+        putNative(out, (int32_t)0);
+        putNative(out, (int32_t)0);
+        putNative(out, (int32_t)(width - 1));
+        putNative(out, (int32_t)(height - 1));
+    }
+
+    putString(out, "lineOrder");
+    putString(out, "lineOrder");
+    putNative(out, (int32_t)1);
+    out.push_back(0);  // INCREASING_Y
+
+    putString(out, "pixelAspectRatio");
+    putString(out, "float");
+    putNative(out, (int32_t)4);
+    putNative(out, 1.0f);
+
+    putString(out, "screenWindowCenter");
+    putString(out, "v2f");
+    putNative(out, (int32_t)8);
+    putNative(out, 0.0f);
+    putNative(out, 0.0f);
+
+    putString(out, "screenWindowWidth");
+    putString(out, "float");
+    putNative(out, (int32_t)4);
+    putNative(out, 1.0f);
+    out.push_back(0);  // end of header
+
+    // Line offset table, then one block per scanline: y, byte count, pixels
+    size_t rowBytes = (size_t)width * sizeof(float);
+    uint64_t offset = out.size() + (size_t)height * sizeof(uint64_t);
+    for (int y = 0; y < height; y++) {
+        putNative(out, offset);
+        offset += 8 + rowBytes;
+    }
+    for (int y = 0; y < height; y++) {
+        putNative(out, (int32_t)y);
+        putNative(out, (int32_t)rowBytes);
+        const uint8_t* row = (const uint8_t*)(depth + (size_t)(height - 1 - y) * width);
+        out.insert(out.end(), row, row + rowBytes);
+    }
+    return writeFile(path, out);
+}
+
+// Rows as-is apart from the flip, for external tools
+inline bool writeRaw(const char* path, const void* pixels, size_t rowBytes, int height, ImageScratch& scratch) {
+    std::vector<uint8_t>& out = scratch.output;
+    out.resize(rowBytes * height);
+    for (int y = 0; y < height; y++)
+        std::memcpy(out.data() + rowBytes * y, (const uint8_t*)pixels + rowBytes * (height - 1 - y), rowBytes);
+    return image_writer::writeFile(path, out);
+}
+
+#endif
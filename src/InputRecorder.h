@@ -0,0 +1,358 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include "Camera.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Movement keys held during a frame
+enum RecordedKey {
+    KEY_FORWARD = 1 << 0,
+    KEY_BACKWARD = 1 << 1,
+    KEY_LEFT = 1 << 2,
+    KEY_RIGHT = 1 << 3,
+};
+
+// Everything that moves the camera in one frame
+struct FrameInput {
+    uint8_t keys = 0;
+    glm::vec2 mouse = glm::vec2(0.0f);  // summed cursor offsets
+};
+
+// Records camera input and parameter edits to a compact binary log and
+// replays them, so performance runs can be repeated frame for frame.
+//
+// While recording or replaying the simulation advances in fixed steps of
+// FIXED_TIMESTEP. Recording accumulates wall-clock time and logs how many
+// whole steps each frame took, so it runs at real-time speed at any frame
+// rate; a replay takes the same number of steps per frame. It reproduces
+// exactly the frames that were recorded, however fast the replay runs.
+//
+// Parameters are registered once with addParam() (append only: the index is
+// the id in the log). Each frame logs the movement keys, the mouse offset and
+// the parameters that changed since syncParams() was last called, which is
+// after animation so only edits are logged.
+//
+// Log layout (native byte order):
+//   header    magic, version, parameter count and sizes, timestep, window
+//             size, frame count
+//   keyframe  camera position, yaw, pitch, simulation time, then every
+//             parameter's value
+//   frames    flags byte (keys in bits 0-3, FLAG_MOUSE, FLAG_PARAMS), step
+//             count byte, [mouse x, y], [count, then index + value per
+//             parameter]
+class InputRecorder {
+public:
+    static constexpr float FIXED_TIMESTEP = 1.0f / 60.0f;
+    static constexpr int MAX_STEPS = 255;  // per frame; longer stalls lose time
+
+    // Timing summary of the last completed replay
+    struct ReplaySummary {
+        int frames = 0;
+        float meanFrameMs = 0.0f;
+        float p95FrameMs = 0.0f;
+        float p99FrameMs = 0.0f;
+        float meanGpuMs = 0.0f;
+    };
+
+    std::string error;  // last load/save error, shown in the UI
+    ReplaySummary summary;
+
+    template <typename T>
+    void addParam(T* value) {
+        static_assert(std::is_trivially_copyable<T>::value, "parameters are logged as raw bytes");
+        Param param;
+        param.value = value;
+        param.size = (uint8_t)sizeof(T);
+        param.offset = paramBytes;
+        params.push_back(param);
+        paramBytes += sizeof(T);
+    }
+
+    bool recording() const { return mode == RECORDING; }
+    bool replaying() const { return mode == REPLAYING; }
+    bool active() const { return mode != IDLE; }
+    int frameCount() const { return frames; }
+    int replayLength() const { return totalFrames; }
+
+    void startRecording(const Camera& camera, float simulationTime, unsigned int width, unsigned int height) {
+        log.clear();
+        log.reserve(1024 * 1024);
+        frames = 0;
+        accumulator = 0.0f;
+        error.clear();
+
+        uint16_t count = (uint16_t)params.size();
+        write(MAGIC);
+        write(VERSION);
+        write(count);
+        for (const Param& param : params)
+            write(param.size);
+        write(FIXED_TIMESTEP);
+        write((uint32_t)width);
+        write((uint32_t)height);
+        frameCountOffset = log.size();
+        write((uint32_t)0);
+
+        write(camera.Position);
+        write(camera.Yaw);
+        write(camera.Pitch);
+        write(simulationTime);
+        syncParams();
+        append(shadow.data(), shadow.size());
+        mode = RECORDING;
+    }
+
+    bool stopRecording(const std::string& path) {
+        mode = IDLE;
+        uint32_t count = (uint32_t)frames;
+        std::memcpy(log.data() + frameCountOffset, &count, sizeof(count));
+        std::ofstream file(path, std::ios::binary);
+        file.write((const char*)log.data(), (std::streamsize)log.size());
+        if (!file) {
+            error = "Could not write " + path;
+            return false;
+        }
+        std::cout << "Recorded " << frames << " frames (" << log.size() / 1024.0f << " KB) to " << path << "\n";
+        return true;
+    }
+
+    // Load a log and restore its starting camera, time and parameters
+    bool startReplay(const std::string& path, Camera& camera, float& simulationTime,
+                     unsigned int width, unsigned int height) {
+        error.clear();
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            error = "Could not open " + path;
+            return false;
+        }
+        log.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        cursor = 0;
+
+        uint32_t magic = 0, logWidth = 0, logHeight = 0, count = 0;
+        uint16_t version = 0, paramCount = 0;
+        float timestep = 0.0f;
+        bool valid = read(magic) && magic == MAGIC && read(version) && version == VERSION &&
+                     read(paramCount) && paramCount == params.size();
+        for (size_t i = 0; valid && i < params.size(); i++) {
+            uint8_t size = 0;
+            valid = read(size) && size == params[i].size;
+        }
+        valid = valid && read(timestep) && timestep == FIXED_TIMESTEP &&
+                read(logWidth) && read(logHeight) && read(count);
+
+        glm::vec3 position;
+        float yaw = 0.0f, pitch = 0.0f, time = 0.0f;
+        valid = valid && read(position) && read(yaw) && read(pitch) && read(time) &&
+                cursor + paramBytes <= log.size();
+        if (!valid) {
+            error = path + " is not a recording of this build's parameters";
+            log.clear();
+            return false;
+        }
+        if (logWidth != width || logHeight != height)
+            std::cout << "Replay: recorded at " << logWidth << "x" << logHeight << ", window is " << width << "x" << height << "\n";
+
+        camera.Position = position;
+        camera.SetOrientation(yaw, pitch);
+        simulationTime = time;
+        shadow.assign(log.begin() + cursor, log.begin() + cursor + paramBytes);
+        cursor += paramBytes;
+        for (const Param& param : params)
+            std::memcpy(param.value, shadow.data() + param.offset, param.size);
+
+        frames = 0;
+        totalFrames = (int)count;
+        frameMs.clear();
+        gpuMs.clear();
+        frameMs.reserve(totalFrames);
+        gpuMs.reserve(totalFrames);
+        mode = REPLAYING;
+        return true;
+    }
+
+    void stopReplay() {
+        mode = IDLE;
+        log.clear();
+        finishSummary();
+    }
+
+    // Call once per frame after the UI had its chance to edit parameters,
+    // with the frame's wall-clock time. Sets steps to the number of fixed
+    // steps the simulation takes this frame. Recording appends input, steps
+    // and edits to the log. Replaying replaces input and steps with the
+    // logged frame's and applies its edits; returns false once the log is
+    // exhausted (the replay then stops by itself).
+    bool processFrame(FrameInput& input, float deltaTime, int& steps) {
+        steps = 0;
+        if (mode == RECORDING) {
+            accumulator += deltaTime;
+            steps = std::min((int)(accumulator / FIXED_TIMESTEP), MAX_STEPS);
+            accumulator = std::min(accumulator - steps * FIXED_TIMESTEP, FIXED_TIMESTEP);
+            recordFrame(input, (uint8_t)steps);
+            return true;
+        }
+        if (mode == REPLAYING) {
+            if (frames >= totalFrames || !replayFrame(input, steps)) {
+                if (frames < totalFrames)
+                    error = "Recording is truncated";
+                stopReplay();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Remember the current parameter values, so the next processFrame() only
+    // logs edits made after this point
+    void syncParams() {
+        shadow.resize(paramBytes);
+        for (const Param& param : params)
+            std::memcpy(shadow.data() + param.offset, param.value, param.size);
+    }
+
+    // Wall-clock time and latest GPU time of the previous frame, sampled
+    // from the second replayed frame on
+    void addReplayTiming(float frame, float gpu) {
+        if (mode == REPLAYING && frames > 0) {
+            frameMs.push_back(frame);
+            gpuMs.push_back(gpu);
+        }
+    }
+
+private:
+    enum Mode { IDLE, RECORDING, REPLAYING };
+
+    struct Param {
+        void* value;
+        uint8_t size;
+        size_t offset;  // into shadow
+    };
+
+    static constexpr uint32_t MAGIC = 0x43455247;  // "GREC"
+    static constexpr uint16_t VERSION = 3;
+    static constexpr uint8_t FLAG_KEYS = 0x0F;
+    static constexpr uint8_t FLAG_MOUSE = 1 << 4;
+    static constexpr uint8_t FLAG_PARAMS = 1 << 5;
+
+    Mode mode = IDLE;
+    std::vector<Param> params;
+    size_t paramBytes = 0;
+    std::vector<uint8_t> shadow;  // parameter values as of the last sync
+    std::vector<uint8_t> log;
+    size_t cursor = 0;
+    size_t frameCountOffset = 0;
+    int frames = 0;
+    int totalFrames = 0;
+    float accumulator = 0.0f;  // recorded wall-clock time not yet stepped
+    std::vector<float> frameMs;
+    std::vector<float> gpuMs;
+
+    void append(const void* data, size_t size) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        log.insert(log.end(), bytes, bytes + size);
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        append(&value, sizeof(T));
+    }
+
+    template <typename T>
+    bool read(T& value) {
+        if (cursor + sizeof(T) > log.size())
+            return false;
+        std::memcpy(&value, log.data() + cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    void recordFrame(const FrameInput& input, uint8_t steps) {
+        size_t flagsAt = log.size();
+        uint8_t flags = input.keys & FLAG_KEYS;
+        write(flags);
+        write(steps);
+        if (input.mouse.x != 0.0f || input.mouse.y != 0.0f) {
+            flags |= FLAG_MOUSE;
+            write(input.mouse);
+        }
+
+        size_t countAt = log.size();
+        uint16_t changed = 0;
+        write(changed);
+        for (size_t i = 0; i < params.size(); i++) {
+            const Param& param = params[i];
+            if (std::memcmp(shadow.data() + param.offset, param.value, param.size) == 0)
+                continue;
+            write((uint16_t)i);
+            append(param.value, param.size);
+            changed++;
+        }
+        if (changed > 0) {
+            flags |= FLAG_PARAMS;
+            std::memcpy(log.data() + countAt, &changed, sizeof(changed));
+        } else {
+            log.resize(countAt);
+        }
+        log[flagsAt] = flags;
+        frames++;
+    }
+
+    bool replayFrame(FrameInput& input, int& steps) {
+        uint8_t flags = 0, stepCount = 0;
+        if (!read(flags) || !read(stepCount))
+            return false;
+        steps = stepCount;
+        input.keys = flags & FLAG_KEYS;
+        input.mouse = glm::vec2(0.0f);
+        if ((flags & FLAG_MOUSE) && !read(input.mouse))
+            return false;
+        if (flags & FLAG_PARAMS) {
+            uint16_t changed = 0;
+            if (!read(changed))
+                return false;
+            for (uint16_t n = 0; n < changed; n++) {
+                uint16_t index = 0;
+                if (!read(index) || index >= params.size())
+                    return false;
+                const Param& param = params[index];
+                if (cursor + param.size > log.size())
+                    return false;
+                std::memcpy(param.value, log.data() + cursor, param.size);
+                cursor += param.size;
+            }
+        }
+        frames++;
+        return true;
+    }
+
+    void finishSummary() {
+        if (frameMs.empty())
+            return;
+        summary = ReplaySummary();
+        summary.frames = (int)frameMs.size();
+        for (size_t i = 0; i < frameMs.size(); i++) {
+            summary.meanFrameMs += frameMs[i] / frameMs.size();
+            summary.meanGpuMs += gpuMs[i] / gpuMs.size();
+        }
+        std::sort(frameMs.begin(), frameMs.end());
+        summary.p95FrameMs = frameMs[(frameMs.size() - 1) * 95 / 100];
+        summary.p99FrameMs = frameMs[(frameMs.size() - 1) * 99 / 100];
+        frameMs.clear();
+        gpuMs.clear();
+
+        std::cout << "Replay: " << summary.frames << " frames, frame " << summary.meanFrameMs << " ms mean / "
+                  << summary.p95FrameMs << " ms p95 / " << summary.p99FrameMs << " ms p99, GPU "
+                  << summary.meanGpuMs << " ms mean\n";
+    }
+};
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef OCCLUSION_BENCHMARK_H
+#define OCCLUSION_BENCHMARK_H
+
+#include "OcclusionCuller.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Rasterizer throughput and cull rate of the CPU occlusion culler on dense
+// generated scenes: a grid of boxes of random size on the ground plane, seen
+// from street level so most of the grid hides behind the first rows.
+//
+// Runs on its own thread with its own OcclusionCuller so the UI stays
+// responsive. It competes with the render thread for cores, so the numbers
+// are most meaningful with a light scene in the window.
+class OcclusionBenchmark {
+public:
+    static const int SCENES = 3;
+    static const int WARMUP_ITERATIONS = 5;
+    static const int ITERATIONS = 50;
+
+    struct Result {
+        int instances;
+        int triangles;       // front-facing triangles binned per run
+        float setupMs;
+        float rasterMs;
+        float testMs;
+        float trianglesPerMs;  // setup + raster
+        float cullRate;        // fraction of instances culled
+    };
+
+    Result results[SCENES];
+    int resultCount = 0;
+    int threads = 0;
+
+    ~OcclusionBenchmark() {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    bool running() const { return busy.load(std::memory_order_acquire); }
+
+    void start(const OccluderMesh* cube, const OccluderMesh* plane, int workerThreads) {
+        if (running())
+            return;
+        if (worker.joinable())
+            worker.join();
+        resultCount = 0;
+        busy.store(true, std::memory_order_release);
+        worker = std::thread(&OcclusionBenchmark::run, this, cube, plane, workerThreads);
+    }
+
+    void print() const {
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << "Occlusion culling benchmark (" << threads << " threads, "
+                  << (OcclusionCuller::usesAvx2() ? "AVX2" : "scalar") << ")\n";
+        std::cout << std::setw(10) << "boxes" << std::setw(12) << "triangles" << std::setw(12) << "setup ms"
+                  << std::setw(12) << "raster ms" << std::setw(12) << "test ms" << std::setw(12) << "tris/ms"
+                  << std::setw(10) << "culled" << "\n";
+        for (int i = 0; i < resultCount; i++) {
+            const Result& result = results[i];
+            std::cout << std::setw(10) << result.instances << std::setw(12) << result.triangles
+                      << std::fixed << std::setprecision(3)
+                      << std::setw(12) << result.setupMs << std::setw(12) << result.rasterMs
+                      << std::setw(12) << result.testMs << std::setprecision(0)
+                      << std::setw(12) << result.trianglesPerMs << std::setprecision(1)
+                      << std::setw(9) << result.cullRate * 100.0f << "%\n";
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+
+    static int sceneSize(int scene) {
+        static const int sizes[SCENES] = { 32, 64, 128 };  // boxes per grid side
+        return sizes[scene];
+    }
+
+private:
+    std::thread worker;
+    std::atomic<bool> busy{false};
+
+    void run(const OccluderMesh* cube, const OccluderMesh* plane, int workerThreads) {
+        OcclusionCuller culler(workerThreads);
+        threads = culler.threadCount();
+
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+        std::vector<OcclusionInstance> instances;
+        std::vector<uint8_t> visible;
+        for (int scene = 0; scene < SCENES; scene++) {
+            int side = sceneSize(scene);
+            float spacing = 3.0f;
+            float extent = side * spacing;
+            buildScene(instances, side, spacing, cube, plane);
+            visible.assign(instances.size(), 1);
+
+            glm::vec3 eye(-4.0f, 2.0f, -4.0f);
+            glm::vec3 target(extent * 0.5f, 1.0f, extent * 0.5f);
+            glm::mat4 viewProjection = projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+            Result& result = results[scene];
+            result = Result();
+            result.instances = (int)instances.size();
+            for (int i = 0; i < WARMUP_ITERATIONS + ITERATIONS; i++) {
+                culler.cull(viewProjection, instances.data(), instances.size(), visible.data());
+                if (i < WARMUP_ITERATIONS)
+                    continue;
+                result.setupMs += culler.stats.setupMs / ITERATIONS;
+                result.rasterMs += culler.stats.rasterMs / ITERATIONS;
+                result.testMs += culler.stats.testMs / ITERATIONS;
+            }
+            result.triangles = culler.stats.triangles;
+            result.trianglesPerMs = result.triangles / std::max(result.setupMs + result.rasterMs, 1e-6f);
+            result.cullRate = (float)culler.stats.culled / result.instances;
+            resultCount = scene + 1;
+        }
+
+        print();
+        busy.store(false, std::memory_order_release);
+    }
+
+    static void buildScene(std::vector<OcclusionInstance>& instances, int side, float spacing,
+                           const OccluderMesh* cube, const OccluderMesh* plane) {
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> width(1.0f, 2.5f);
+        std::uniform_real_distribution<float> height(1.0f, 8.0f);
+
+        instances.clear();
+        instances.reserve(side * side + 1);
+        OcclusionInstance ground;
+        float extent = side * spacing;
+        ground.model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(extent * 0.5f, 0.0f, extent * 0.5f)),
+                                  glm::vec3(extent / 50.0f, 1.0f, extent / 50.0f));
+        ground.mesh = plane;
+        instances.push_back(ground);
+
+        for (int z = 0; z < side; z++) {
+            for (int x = 0; x < side; x++) {
+                glm::vec3 size(width(random), height(random), width(random));
+                glm::vec3 position(x * spacing, size.y * 0.5f - 0.5f, z * spacing);
+                OcclusionInstance box;
+                box.model = glm::scale(glm::translate(glm::mat4(1.0f), position), size);
+                box.mesh = cube;
+                instances.push_back(box);
+            }
+        }
+    }
+};
+
+#endif
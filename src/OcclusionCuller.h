@@ -0,0 +1,384 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include "OcclusionRaster.h"
+#include "WorkerPool.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Simplified mesh rasterized as an occluder. Triangles are wound
+// counter-clockwise when seen from outside; back faces are skipped.
+struct OccluderMesh {
+    const glm::vec3* vertices;
+    int vertexCount;
+    const uint16_t* indices;
+    int triangleCount;
+    glm::vec3 boundsMin;  // local-space bounds tested as the occludee
+    glm::vec3 boundsMax;
+};
+
+struct OcclusionInstance {
+    glm::mat4 model;
+    const OccluderMesh* mesh;
+};
+
+// Timings and counts of the last cull() call
+struct OcclusionStats {
+    int instances = 0;
+    int triangles = 0;  // front-facing triangles that reached the bins
+    int culled = 0;     // instances hidden or entirely off screen
+    float setupMs = 0.0f;
+    float rasterMs = 0.0f;
+    float testMs = 0.0f;
+};
+
+// Software depth rasterizer for occlusion culling, entirely on the CPU so
+// results are available in the same frame without any GPU readback.
+//
+// cull() works in three parallel phases on a WorkerPool:
+//   setup   each task transforms a contiguous range of instances, sets up
+//           their front-facing triangles and bins them into screen tiles
+//   raster  each task owns one tile and rasterizes its bins in instance
+//           order, so no two threads ever touch the same depth values
+//   test    each instance's bounding box is projected to a screen rectangle
+//           at its nearest depth and compared against the buffer
+//
+// The buffer is low resolution and stored tile by tile. On CPUs with AVX2 and
+// FMA the inner loops of OcclusionRasterAvx2.cpp cover 8 samples of a row per
+// instruction; elsewhere the scalar loops below run.
+//
+// Samples sit on the corners of the buffer's cells, not their centers, and
+// edges are inclusive. A box is hidden only if every corner of every cell
+// under its rectangle holds a nearer depth than the box. For a convex
+// occluder (each of the meshes here) covering all four corners of a cell
+// covers the whole cell. Its front surface depth is a convex function, so
+// its farthest depth in the cell is at one of those corners. An object
+// whose box is hidden behind a single convex occluder is never dropped. A
+// gap narrower than a cell between two different occluders can still be
+// missed. Triangles crossing the near plane are not rasterized. Boxes
+// crossing it, or reaching the last row or column (which have no corner
+// samples beyond them), always pass.
+class OcclusionCuller {
+public:
+    static const int WIDTH = occlusion_raster::WIDTH;
+    static const int HEIGHT = occlusion_raster::HEIGHT;
+    static const int TILE_WIDTH = occlusion_raster::TILE_WIDTH;
+    static const int TILE_HEIGHT = occlusion_raster::TILE_HEIGHT;
+    static const int TILES_X = occlusion_raster::TILES_X;
+    static const int TILES_Y = occlusion_raster::TILES_Y;
+    static const int TILE_PIXELS = occlusion_raster::TILE_PIXELS;
+
+    OcclusionStats stats;
+
+    explicit OcclusionCuller(int workerThreads)
+        : pool(workerThreads), depth(WIDTH * HEIGHT, 1.0f),
+          chunkTriangles(pool.size() * 2),
+          bins(chunkTriangles.size() * TILES_X * TILES_Y) {}
+
+    // Rasterize every instance as an occluder, then test each one's bounds.
+    // visible[i] is set to 0 for instances that are hidden, 1 otherwise.
+    void cull(const glm::mat4& viewProjection, const OcclusionInstance* instances, size_t count, uint8_t* visible) {
+        auto start = std::chrono::steady_clock::now();
+        // The tasks only capture this, so std::function never allocates
+        job.viewProjection = viewProjection;
+        job.instances = instances;
+        job.count = count;
+        job.visible = visible;
+        job.culled.store(0, std::memory_order_relaxed);
+        clipMatrices.resize(count);
+
+        int chunks = (int)chunkTriangles.size();
+        pool.parallelFor(chunks, [this](int chunk, int) {
+            setupChunk(chunk);
+        });
+        auto setupEnd = std::chrono::steady_clock::now();
+
+        pool.parallelFor(TILES_X * TILES_Y, [this](int tile, int) {
+            rasterizeTile(tile);
+        });
+        auto rasterEnd = std::chrono::steady_clock::now();
+
+        pool.parallelFor(chunks, [this](int chunk, int) {
+            testChunk(chunk);
+        });
+        auto testEnd = std::chrono::steady_clock::now();
+
+        stats.instances = (int)count;
+        stats.triangles = 0;
+        for (const std::vector<Triangle>& triangles : chunkTriangles)
+            stats.triangles += (int)triangles.size();
+        stats.culled = job.culled.load();
+        stats.setupMs = std::chrono::duration<float, std::milli>(setupEnd - start).count();
+        stats.rasterMs = std::chrono::duration<float, std::milli>(rasterEnd - setupEnd).count();
+        stats.testMs = std::chrono::duration<float, std::milli>(testEnd - rasterEnd).count();
+    }
+
+    int threadCount() const { return pool.size(); }
+
+    // True if the AVX2 kernels were built (ENGINE_AVX2) and this CPU and OS
+    // support AVX2 and FMA
+    static bool usesAvx2() {
+#ifdef ENGINE_AVX2
+        static const bool supported = cpuSupportsAvx2();
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    // Depth at sample (x, y), the lower left corner of cell (x, y), y up
+    float depthAt(int x, int y) const {
+        int tile = (y / TILE_HEIGHT) * TILES_X + x / TILE_WIDTH;
+        return depth[tile * TILE_PIXELS + (y % TILE_HEIGHT) * TILE_WIDTH + x % TILE_WIDTH];
+    }
+
+private:
+    typedef occlusion_raster::Triangle Triangle;
+
+    static constexpr int MAX_MESH_VERTICES = 8;
+    static constexpr float NEAR_W = 1e-4f;
+    static constexpr float DEPTH_EPSILON = 1e-5f;
+
+    // Arguments of the cull() in progress
+    struct Job {
+        glm::mat4 viewProjection;
+        const OcclusionInstance* instances = nullptr;
+        size_t count = 0;
+        uint8_t* visible = nullptr;
+        std::atomic<int> culled{0};
+    };
+
+    WorkerPool pool;
+    Job job;
+    std::vector<float> depth;  // tile-major, rows of TILE_WIDTH inside a tile
+    std::vector<glm::mat4> clipMatrices;  // viewProjection * model per instance
+    std::vector<std::vector<Triangle>> chunkTriangles;
+    std::vector<std::vector<uint32_t>> bins;  // [chunk][tile] triangle indices
+
+    std::vector<uint32_t>& bin(int chunk, int tile) {
+        return bins[chunk * TILES_X * TILES_Y + tile];
+    }
+
+    // GL clips everything with z < -w, so geometry there can't occlude anything
+    static bool inFrontOfNearPlane(const glm::vec4& clip) {
+        return clip.w > NEAR_W && clip.z > -clip.w;
+    }
+
+    static glm::vec3 toScreen(const glm::vec4& clip) {
+        float invW = 1.0f / clip.w;
+        return glm::vec3((clip.x * invW * 0.5f + 0.5f) * WIDTH,
+                         (clip.y * invW * 0.5f + 0.5f) * HEIGHT,
+                         clip.z * invW * 0.5f + 0.5f);
+    }
+
+    // Instances [begin, end) handled by a setup or test task
+    void chunkRange(int chunk, size_t& begin, size_t& end) const {
+        size_t chunks = chunkTriangles.size();
+        begin = job.count * chunk / chunks;
+        end = job.count * (chunk + 1) / chunks;
+    }
+
+    void setupChunk(int chunk) {
+        std::vector<Triangle>& triangles = chunkTriangles[chunk];
+        triangles.clear();
+        for (int tile = 0; tile < TILES_X * TILES_Y; tile++)
+            bin(chunk, tile).clear();
+
+        size_t begin, end;
+        chunkRange(chunk, begin, end);
+        for (size_t i = begin; i < end; i++) {
+            const OccluderMesh& mesh = *job.instances[i].mesh;
+            glm::mat4 clipMatrix = job.viewProjection * job.instances[i].model;
+            clipMatrices[i] = clipMatrix;
+
+            glm::vec3 screen[MAX_MESH_VERTICES];
+            bool inFront[MAX_MESH_VERTICES];
+            int vertexCount = std::min(mesh.vertexCount, MAX_MESH_VERTICES);
+            for (int v = 0; v < vertexCount; v++) {
+                glm::vec4 clip = clipMatrix * glm::vec4(mesh.vertices[v], 1.0f);
+                inFront[v] = inFrontOfNearPlane(clip);
+                if (inFront[v])
+                    screen[v] = toScreen(clip);
+            }
+
+            for (int t = 0; t < mesh.triangleCount; t++) {
+                const uint16_t* index = mesh.indices + t * 3;
+                if (!inFront[index[0]] || !inFront[index[1]] || !inFront[index[2]])
+                    continue;
+                Triangle triangle;
+                if (!setupTriangle(screen[index[0]], screen[index[1]], screen[index[2]], triangle))
+                    continue;
+
+                uint32_t triangleIndex = (uint32_t)triangles.size();
+                triangles.push_back(triangle);
+                for (int ty = triangle.minY / TILE_HEIGHT; ty <= triangle.maxY / TILE_HEIGHT; ty++) {
+                    for (int tx = triangle.minX / TILE_WIDTH; tx <= triangle.maxX / TILE_WIDTH; tx++)
+                        bin(chunk, ty * TILES_X + tx).push_back(triangleIndex);
+                }
+            }
+        }
+    }
+
+    // Returns false for back-facing, degenerate and off-screen triangles
+    static bool setupTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, Triangle& triangle) {
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+        if (!(area > 1e-6f))
+            return false;
+
+        float minX = std::min(v0.x, std::min(v1.x, v2.x));
+        float maxX = std::max(v0.x, std::max(v1.x, v2.x));
+        float minY = std::min(v0.y, std::min(v1.y, v2.y));
+        float maxY = std::max(v0.y, std::max(v1.y, v2.y));
+        triangle.minX = std::max(0, (int)std::floor(minX));
+        triangle.maxX = std::min(WIDTH - 1, (int)std::floor(maxX));
+        triangle.minY = std::max(0, (int)std::floor(minY));
+        triangle.maxY = std::min(HEIGHT - 1, (int)std::floor(maxY));
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+            return false;
+
+        // Edge i is opposite vertex i
+        const glm::vec3* v[3] = { &v0, &v1, &v2 };
+        for (int i = 0; i < 3; i++) {
+            const glm::vec3& a = *v[(i + 1) % 3];
+            const glm::vec3& b = *v[(i + 2) % 3];
+            triangle.edgeA[i] = a.y - b.y;
+            triangle.edgeB[i] = b.x - a.x;
+            triangle.edgeC[i] = a.x * b.y - b.x * a.y;
+        }
+
+        float invArea = 1.0f / area;
+        triangle.zA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) * invArea;
+        triangle.zB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) * invArea;
+        triangle.zC = v0.z - triangle.zA * v0.x - triangle.zB * v0.y;
+        return true;
+    }
+
+    void testChunk(int chunk) {
+        size_t begin, end;
+        chunkRange(chunk, begin, end);
+        int hidden = 0;
+        for (size_t i = begin; i < end; i++) {
+            job.visible[i] = testBounds(clipMatrices[i], *job.instances[i].mesh) ? 1 : 0;
+            hidden += 1 - job.visible[i];
+        }
+        job.culled.fetch_add(hidden, std::memory_order_relaxed);
+    }
+
+    void rasterizeTile(int tile) {
+        float* tileDepth = depth.data() + tile * TILE_PIXELS;
+        std::fill(tileDepth, tileDepth + TILE_PIXELS, 1.0f);
+
+        int tileX = (tile % TILES_X) * TILE_WIDTH;
+        int tileY = (tile / TILES_X) * TILE_HEIGHT;
+        bool avx2 = usesAvx2();
+        for (size_t chunk = 0; chunk < chunkTriangles.size(); chunk++) {
+            const std::vector<Triangle>& triangles = chunkTriangles[chunk];
+            for (uint32_t index : bin((int)chunk, tile)) {
+                const Triangle& triangle = triangles[index];
+                int x0 = std::max(triangle.minX, tileX);
+                int x1 = std::min(triangle.maxX, tileX + TILE_WIDTH - 1);
+                int y0 = std::max(triangle.minY, tileY);
+                int y1 = std::min(triangle.maxY, tileY + TILE_HEIGHT - 1);
+                if (avx2)
+                    occlusion_raster::rasterizeTriangleAvx2(triangle, tileDepth, tileX, tileY, x0, x1, y0, y1);
+                else
+                    rasterizeTriangle(triangle, tileDepth, tileX, tileY, x0, x1, y0, y1);
+            }
+        }
+    }
+
+    static void rasterizeTriangle(const Triangle& triangle, float* tileDepth, int tileX, int tileY,
+                                  int x0, int x1, int y0, int y1) {
+        for (int y = y0; y <= y1; y++) {
+            float py = (float)y;
+            float* row = tileDepth + (y - tileY) * TILE_WIDTH - tileX;
+            for (int x = x0; x <= x1; x++) {
+                float px = (float)x;
+                if (triangle.edgeA[0] * px + triangle.edgeB[0] * py + triangle.edgeC[0] < 0.0f ||
+                    triangle.edgeA[1] * px + triangle.edgeB[1] * py + triangle.edgeC[1] < 0.0f ||
+                    triangle.edgeA[2] * px + triangle.edgeB[2] * py + triangle.edgeC[2] < 0.0f)
+                    continue;
+                float z = triangle.zA * px + triangle.zB * py + triangle.zC;
+                row[x] = std::min(row[x], z);
+            }
+        }
+    }
+
+    bool testRect(int x0, int x1, int y0, int y1, float minZ) const {
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                if (depthAt(x, y) >= minZ - DEPTH_EPSILON)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    // Project the instance's bounding box and compare its nearest depth with
+    // the corner samples of every cell under its screen rectangle
+    bool testBounds(const glm::mat4& clipMatrix, const OccluderMesh& mesh) const {
+        float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1e30f;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 local((corner & 1) ? mesh.boundsMax.x : mesh.boundsMin.x,
+                            (corner & 2) ? mesh.boundsMax.y : mesh.boundsMin.y,
+                            (corner & 4) ? mesh.boundsMax.z : mesh.boundsMin.z);
+            glm::vec4 clip = clipMatrix * glm::vec4(local, 1.0f);
+            if (!inFrontOfNearPlane(clip))
+                return true;  // crosses the near plane
+            glm::vec3 screen = toScreen(clip);
+            minX = std::min(minX, screen.x);
+            maxX = std::max(maxX, screen.x);
+            minY = std::min(minY, screen.y);
+            maxY = std::max(maxY, screen.y);
+            minZ = std::min(minZ, screen.z);
+        }
+        if (maxX < 0.0f || maxY < 0.0f || minX >= WIDTH || minY >= HEIGHT || minZ > 1.0f)
+            return false;  // off screen or beyond the far plane
+
+        // Cells x0..x1 have their corners at samples x0..x1 + 1
+        int x0 = std::max(0, (int)std::floor(minX));
+        int x1 = (int)std::floor(maxX) + 1;
+        int y0 = std::max(0, (int)std::floor(minY));
+        int y1 = (int)std::floor(maxY) + 1;
+        if (x1 >= WIDTH || y1 >= HEIGHT)
+            return true;
+        if (usesAvx2())
+            return occlusion_raster::testRectAvx2(depth.data(), x0, x1, y0, y1, minZ - DEPTH_EPSILON);
+        return testRect(x0, x1, y0, y1, minZ);
+    }
+
+#ifdef ENGINE_AVX2
+    // AVX2 and FMA instructions plus OS support for saving YMM registers
+    static bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        bool fma = (info[2] & (1 << 12)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+        return false;
+#endif
+    }
+#endif
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef OCCLUSION_RASTER_H
+#define OCCLUSION_RASTER_H
+
+// Depth buffer layout and triangle setup shared by OcclusionCuller and the
+// AVX2 kernels in OcclusionRasterAvx2.cpp.
+//
+// That file is the only one built with AVX2 enabled, so this header must stay
+// free of inline functions: the linker may keep any one copy of an inline
+// function, and an AVX2-compiled copy would crash CPUs without AVX2.
+namespace occlusion_raster {
+
+const int WIDTH = 256;
+const int HEIGHT = 128;
+const int TILE_WIDTH = 32;  // multiple of 8 for the AVX2 spans
+const int TILE_HEIGHT = 16;
+const int TILES_X = WIDTH / TILE_WIDTH;
+const int TILES_Y = HEIGHT / TILE_HEIGHT;
+const int TILE_PIXELS = TILE_WIDTH * TILE_HEIGHT;
+
+// Screen-space triangle: edge functions are >= 0 inside and depth is a
+// plane in buffer coordinates (z/w is linear in screen space)
+struct Triangle {
+    float edgeA[3], edgeB[3], edgeC[3];
+    float zA, zB, zC;
+    int minX, minY, maxX, maxY;
+};
+
+// Keep the nearest depth of the triangle at samples [x0, x1] x [y0, y1] of
+// one tile. tileDepth points at the tile, whose lower left is (tileX, tileY).
+void rasterizeTriangleAvx2(const Triangle& triangle, float* tileDepth, int tileX, int tileY,
+                           int x0, int x1, int y0, int y1);
+
+// True if any sample in [x0, x1] x [y0, y1] of the tile-major buffer is at or
+// behind boxDepth
+bool testRectAvx2(const float* depth, int x0, int x1, int y0, int y1, float boxDepth);
+
+}
+
+#endif
@@ -0,0 +1,64 @@
+// AVX2/FMA inner loops of the CPU occlusion rasterizer. Built with AVX2 and
+// FMA enabled (see ENGINE_AVX2 in CMakeLists.txt) and only called after
+// OcclusionCuller::usesAvx2() has checked the CPU. Nothing in here may be
+// inline code shared with other files; see OcclusionRaster.h.
+#include "OcclusionRaster.h"
+#include <immintrin.h>
+
+namespace occlusion_raster {
+
+// Sample positions x .. x + 7 of an 8-sample span
+static __m256 spanSamples(int x) {
+    return _mm256_add_ps(_mm256_set1_ps((float)x), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+}
+
+void rasterizeTriangleAvx2(const Triangle& triangle, float* tileDepth, int tileX, int tileY,
+                           int x0, int x1, int y0, int y1) {
+    __m256 edgeA0 = _mm256_set1_ps(triangle.edgeA[0]);
+    __m256 edgeA1 = _mm256_set1_ps(triangle.edgeA[1]);
+    __m256 edgeA2 = _mm256_set1_ps(triangle.edgeA[2]);
+    __m256 zA = _mm256_set1_ps(triangle.zA);
+    int spanStart = tileX + ((x0 - tileX) & ~7);
+    for (int y = y0; y <= y1; y++) {
+        float py = (float)y;
+        __m256 rowEdge0 = _mm256_set1_ps(triangle.edgeB[0] * py + triangle.edgeC[0]);
+        __m256 rowEdge1 = _mm256_set1_ps(triangle.edgeB[1] * py + triangle.edgeC[1]);
+        __m256 rowEdge2 = _mm256_set1_ps(triangle.edgeB[2] * py + triangle.edgeC[2]);
+        __m256 rowZ = _mm256_set1_ps(triangle.zB * py + triangle.zC);
+        float* row = tileDepth + (y - tileY) * TILE_WIDTH - tileX;
+        for (int x = spanStart; x <= x1; x += 8) {
+            __m256 px = spanSamples(x);
+            // A negative edge value sets the sign bit: outside
+            __m256 outside = _mm256_or_ps(_mm256_or_ps(_mm256_fmadd_ps(edgeA0, px, rowEdge0),
+                                                       _mm256_fmadd_ps(edgeA1, px, rowEdge1)),
+                                          _mm256_fmadd_ps(edgeA2, px, rowEdge2));
+            if (_mm256_movemask_ps(outside) == 0xFF)
+                continue;
+            __m256 z = _mm256_fmadd_ps(zA, px, rowZ);
+            __m256 current = _mm256_loadu_ps(row + x);
+            __m256 nearer = _mm256_min_ps(current, z);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(nearer, current, outside));
+        }
+    }
+}
+
+bool testRectAvx2(const float* depth, int x0, int x1, int y0, int y1, float boxDepth) {
+    __m256 box = _mm256_set1_ps(boxDepth);
+    for (int y = y0; y <= y1; y++) {
+        int tileRow = (y / TILE_HEIGHT) * TILES_X;
+        int rowInTile = (y % TILE_HEIGHT) * TILE_WIDTH;
+        for (int x = x0 & ~7; x <= x1; x += 8) {
+            const float* span = depth + (tileRow + x / TILE_WIDTH) * TILE_PIXELS + rowInTile + x % TILE_WIDTH;
+            int first = x0 > x ? x0 - x : 0;
+            int last = x1 - x < 7 ? x1 - x : 7;
+            int lanes = (0xFF >> (7 - last)) & (0xFF << first);
+            // Visible if any sample's occluder is not in front of the box
+            __m256 notOccluded = _mm256_cmp_ps(_mm256_loadu_ps(span), box, _CMP_GE_OQ);
+            if (_mm256_movemask_ps(notOccluded) & lanes)
+                return true;
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,129 @@
+#ifndef PREPASS_BENCHMARK_H
+#define PREPASS_BENCHMARK_H
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+// Compares the lit pass with and without the depth prepass as overdraw grows.
+//
+// Runs on the UI thread across many frames: update() overrides the settings
+// under test before each snapshot is built and accumulates the GPU frame time
+// and lit-pass sample count the render thread published. Stats lag a few
+// frames behind (snapshot queue + query latency), hence the warm-up.
+class PrepassBenchmark {
+public:
+    static const int LAYER_STEPS = 6;
+    static const int RUNS = LAYER_STEPS * 2;
+    static const int WARMUP_FRAMES = 12;
+    static const int MEASURE_FRAMES = 60;
+
+    struct Result {
+        int layers;
+        bool prepass;
+        float gpuMs;
+        double samples;
+    };
+
+    Result results[RUNS];
+    int resultCount = 0;
+
+    bool running() const { return run >= 0; }
+
+    // Remembers the current settings so they can be restored afterwards
+    void start(bool prepass, int layers) {
+        savedPrepass = prepass;
+        savedLayers = layers;
+        run = 0;
+        frame = 0;
+        resultCount = 0;
+        resetAccumulators();
+    }
+
+    // Abandon a run in progress and restore the settings it overrode
+    void stop(bool& prepass, int& layers) {
+        if (!running())
+            return;
+        run = -1;
+        prepass = savedPrepass;
+        layers = savedLayers;
+    }
+
+    // Override the settings for the next frame and record the latest stats
+    void update(bool& prepass, int& layers, float gpuMs, uint64_t samples) {
+        if (!running())
+            return;
+
+        if (frame >= WARMUP_FRAMES) {
+            gpuSum += gpuMs;
+            sampleSum += (double)samples;
+            measured++;
+        }
+        frame++;
+
+        if (frame == WARMUP_FRAMES + MEASURE_FRAMES) {
+            Result& result = results[resultCount++];
+            result.layers = layerCount(run);
+            result.prepass = usesPrepass(run);
+            result.gpuMs = (float)(gpuSum / measured);
+            result.samples = sampleSum / measured;
+
+            run++;
+            frame = 0;
+            resetAccumulators();
+            if (run == RUNS) {
+                run = -1;
+                prepass = savedPrepass;
+                layers = savedLayers;
+                print();
+                return;
+            }
+        }
+
+        layers = layerCount(run);
+        prepass = usesPrepass(run);
+    }
+
+    void print() const {
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << "Depth prepass benchmark (GPU frame time / lit-pass samples passed)\n";
+        std::cout << std::setw(8) << "layers" << std::setw(12) << "off ms" << std::setw(12) << "on ms"
+                  << std::setw(16) << "off samples" << std::setw(16) << "on samples" << "\n";
+        for (int i = 0; i + 1 < resultCount; i += 2) {
+            std::cout << std::setw(8) << results[i].layers
+                      << std::setw(12) << std::fixed << std::setprecision(3) << results[i].gpuMs
+                      << std::setw(12) << results[i + 1].gpuMs
+                      << std::setw(16) << std::setprecision(0) << results[i].samples
+                      << std::setw(16) << results[i + 1].samples << "\n";
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+
+    static int layerCount(int run) {
+        static const int layers[LAYER_STEPS] = { 0, 2, 4, 8, 16, 32 };
+        return layers[run / 2];
+    }
+
+    static bool usesPrepass(int run) {
+        return run % 2 == 1;
+    }
+
+private:
+    int run = -1;
+    int frame = 0;
+    double gpuSum = 0.0;
+    double sampleSum = 0.0;
+    int measured = 0;
+    bool savedPrepass = false;
+    int savedLayers = 0;
+
+    void resetAccumulators() {
+        gpuSum = 0.0;
+        sampleSum = 0.0;
+        measured = 0;
+    }
+};
+
+#endif
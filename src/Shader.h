@@ -7,108 +7,186 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
 
 class Shader {
 public:
-    unsigned int ID;  // The shader program ID
-    
-    // Constructor: reads and builds the shader from file paths
-    Shader(const char* vertexPath, const char* fragmentPath) {
-        // 1. Retrieve the vertex/fragment source code from file paths
-        std::string vertexCode, fragmentCode;
-        std::ifstream vShaderFile, fShaderFile;
-        
-        // Open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        
-        // Read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        
-        // Close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        
-        // Convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-        
+    unsigned int ID = 0;  // The shader program ID
+
+    // Source files and defines the program was built from, kept for reloads
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string defines;
+
+    Shader() {}
+
+    // Constructor: reads and builds the shader from file paths. Optional
+    // defines (e.g. "#define POINT_LIGHT\n") are inserted after #version.
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "")
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines) {
+        unsigned int vertex, fragment;
+        ID = startBuild(vertex, fragment);
+        checkCompileErrors(vertex, "VERTEX");
+        checkCompileErrors(fragment, "FRAGMENT");
+        checkCompileErrors(ID, "PROGRAM");
+
+        // Delete the shaders as they're linked into our program now and no longer necessary
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+    }
+
+    ~Shader() {
+        if (ID != 0)
+            glDeleteProgram(ID);
+    }
+
+    // Owns a GL program, so it can be moved but not copied
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    Shader(Shader&& other) noexcept
+        : ID(other.ID), vertexPath(std::move(other.vertexPath)),
+          fragmentPath(std::move(other.fragmentPath)), defines(std::move(other.defines)) {
+        other.ID = 0;
+    }
+
+    Shader& operator=(Shader&& other) noexcept {
+        if (this != &other) {
+            replaceProgram(other.ID);
+            other.ID = 0;
+            vertexPath = std::move(other.vertexPath);
+            fragmentPath = std::move(other.fragmentPath);
+            defines = std::move(other.defines);
+        }
+        return *this;
+    }
+
+    // Read the sources from disk and issue compile and link without querying
+    // any status, so drivers with parallel compilation don't block here.
+    // Returns the program; the caller checks it and deletes the two shaders.
+    unsigned int startBuild(unsigned int& vertex, unsigned int& fragment) const {
+        std::string vertexCode = injectDefines(readFile(vertexPath), defines);
+        std::string fragmentCode = injectDefines(readFile(fragmentPath), defines);
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
-        
-        // 2. Compile shaders
-        unsigned int vertex, fragment;
-        
-        // Vertex Shader
+
         vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        
-        // Fragment Shader
+
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        
-        // 3. Link shaders into a program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        
-        // Delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+        return program;
     }
-    
+
+    // Take ownership of a linked program, deleting the current one
+    void replaceProgram(unsigned int program) {
+        if (ID != 0 && ID != program)
+            glDeleteProgram(ID);
+        ID = program;
+    }
+
     // Activate the shader
     void use() { 
         glUseProgram(ID); 
     }
     
-    // Utility functions to set uniform values in shaders
-    void setMat4(const std::string &name, const glm::mat4 &mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    // Utility functions to set uniform values in shaders. Names are taken as
+    // const char* so per-frame calls don't build std::string temporaries.
+    void setMat4(const char* name, const glm::mat4 &mat) const {
+        glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     
-    void setVec3(const std::string &name, const glm::vec3 &value) const {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    void setVec2(const char* name, const glm::vec2 &value) const {
+        glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
     
-    void setInt(const std::string &name, int value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    void setVec3(const char* name, const glm::vec3 &value) const {
+        glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
     
-    void setFloat(const std::string &name, float value) const {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    void setInt(const char* name, int value) const {
+        glUniform1i(glGetUniformLocation(ID, name), value);
     }
     
-    void setBool(const std::string &name, bool value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    void setFloat(const char* name, float value) const {
+        glUniform1f(glGetUniformLocation(ID, name), value);
     }
     
-private:
-    // Utility function for checking shader compilation/linking errors
-    void checkCompileErrors(unsigned int shader, std::string type) {
+    void setBool(const char* name, bool value) const {
+        glUniform1i(glGetUniformLocation(ID, name), (int)value);
+    }
+    
+    // Attach a uniform block to a buffer binding point (no-op if the block is unused)
+    void bindUniformBlock(const char* name, unsigned int binding) const {
+        unsigned int index = glGetUniformBlockIndex(ID, name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+    
+    static std::string readFile(const std::string& path) {
+        std::ifstream file(path);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        return stream.str();
+    }
+
+    // Insert defines right after the #version line (which must stay first),
+    // followed by a #line so compile errors still point at the file's lines
+    static std::string injectDefines(const std::string& source, const std::string& defines) {
+        if (defines.empty())
+            return source;
+        size_t insertAt = 0;
+        int nextLine = 1;
+        size_t version = source.find("#version");
+        if (version != std::string::npos) {
+            size_t lineEnd = source.find('\n', version);
+            insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+            for (size_t i = 0; i < insertAt; i++) {
+                if (source[i] == '\n')
+                    nextLine++;
+            }
+        }
+        std::string result = source.substr(0, insertAt);
+        if (!result.empty() && result.back() != '\n')
+            result += '\n';
+        result += defines;
+        result += "#line " + std::to_string(nextLine) + "\n";
+        result += source.substr(insertAt);
+        return result;
+    }
+    
+    // Utility function for checking shader compilation/linking errors. Returns
+    // false on failure and appends the info log to log if one is given.
+    static bool checkCompileErrors(unsigned int shader, const std::string& type, std::string* log = nullptr) {
         int success;
         char infoLog[1024];
+        std::string message;
         if (type != "PROGRAM") {
             glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
             if (!success) {
                 glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n";
+                message = "ERROR::SHADER_COMPILATION_ERROR of type: " + type + "\n" + infoLog + "\n";
             }
         } else {
             glGetProgramiv(shader, GL_LINK_STATUS, &success);
             if (!success) {
                 glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n";
+                message = "ERROR::PROGRAM_LINKING_ERROR of type: " + type + "\n" + infoLog + "\n";
             }
         }
+        if (!success) {
+            std::cout << message;
+            if (log)
+                *log += message;
+        }
+        return success != 0;
     }
 };
 
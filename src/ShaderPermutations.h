@@ -0,0 +1,128 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include "Shader.h"
+#include "ShaderReloader.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Specialized variants of one vertex/fragment pair, keyed by feature bits.
+// Bit i of the key adds "#define <featureDefines[i]>" to both stages, so
+// branches on those settings are resolved by the GLSL preprocessor instead
+// of per pixel. Variants are compiled on first use and cached.
+//
+// First use only queues the build on a ShaderReloader, so a new variant never
+// stalls a frame and its errors reach the UI like any reload's. Until it has
+// linked, get() returns a linked stand-in that differs from it only in the
+// substitutable bits (settings that change the look, not the vertex layout).
+class ShaderPermutations {
+public:
+    ShaderPermutations(const char* vertexPath, const char* fragmentPath,
+                       std::vector<std::string> featureDefines,
+                       std::function<void(Shader&)> setup,
+                       unsigned int substitutable = 0)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath),
+          featureDefines(std::move(featureDefines)), setup(std::move(setup)),
+          substitutable(substitutable), variants((size_t)1 << this->featureDefines.size()) {}
+
+    ~ShaderPermutations() {
+        clear();
+    }
+
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    // The variant for the given feature bits, queueing its build on builder
+    // if needed. Until it links this is the closest linked stand-in, or null
+    // when there is none yet (or it failed to compile).
+    Shader* get(unsigned int features, ShaderReloader& builder) {
+        features &= (unsigned int)variants.size() - 1;
+        std::unique_ptr<Shader>& variant = variants[features];
+        if (!variant) {
+            variant.reset(new Shader());
+            variant->vertexPath = vertexPath;
+            variant->fragmentPath = fragmentPath;
+            variant->defines = definesFor(features);
+            builder.build(*variant, setup);
+        }
+        if (variant->ID != 0)
+            return variant.get();
+        return standIn(features);
+    }
+
+    // Compile a variant right away. Only for start-up, before the first frame.
+    Shader& build(unsigned int features) {
+        std::unique_ptr<Shader>& variant = variants[features & (variants.size() - 1)];
+        if (!variant) {
+            variant.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), definesFor(features)));
+            if (setup)
+                setup(*variant);
+        }
+        return *variant;
+    }
+
+    // Delete all compiled variants, e.g. after the sources changed on disk
+    void clear() {
+        for (std::unique_ptr<Shader>& variant : variants)
+            variant.reset();
+    }
+
+    // The variant for the given feature bits if it has been requested, else
+    // null. It may still be compiling or have failed (ID 0).
+    Shader* compiled(unsigned int features) const {
+        return variants[features & (variants.size() - 1)].get();
+    }
+
+    // Variants with a linked program
+    int compiledCount() const {
+        int count = 0;
+        for (const std::unique_ptr<Shader>& variant : variants) {
+            if (variant && variant->ID != 0)
+                count++;
+        }
+        return count;
+    }
+
+    int variantCount() const { return (int)variants.size(); }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> featureDefines;
+    std::function<void(Shader&)> setup;
+    unsigned int substitutable;  // feature bits a stand-in may differ in
+    std::vector<std::unique_ptr<Shader>> variants;  // indexed by feature bits
+
+    // The linked variant differing from features in the fewest bits, all of
+    // them substitutable
+    Shader* standIn(unsigned int features) const {
+        Shader* best = nullptr;
+        int bestDistance = 0;
+        for (size_t key = 0; key < variants.size(); key++) {
+            unsigned int difference = (unsigned int)key ^ features;
+            if ((difference & ~substitutable) != 0 || !variants[key] || variants[key]->ID == 0)
+                continue;
+            int distance = 0;
+            for (; difference != 0; difference &= difference - 1)
+                distance++;
+            if (best == nullptr || distance < bestDistance) {
+                best = variants[key].get();
+                bestDistance = distance;
+            }
+        }
+        return best;
+    }
+
+    std::string definesFor(unsigned int features) const {
+        std::string defines;
+        for (size_t i = 0; i < featureDefines.size(); i++) {
+            if (features & (1u << i))
+                defines += "#define " + featureDefines[i] + "\n";
+        }
+        return defines;
+    }
+};
+
+#endif
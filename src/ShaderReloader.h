@@ -0,0 +1,171 @@
+#ifndef SHADER_RELOADER_H
+#define SHADER_RELOADER_H
+
+#include "Shader.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Result of the latest reload, written by the render thread and read by the
+// UI. The UI only copies the text when the version has changed.
+class ShaderReloadStatus {
+public:
+    std::atomic<int> pending{0};         // programs still compiling
+    std::atomic<unsigned int> reloads{0}; // successful program swaps
+
+    void publish(const std::string& errors) {
+        std::lock_guard<std::mutex> lock(mutex);
+        text = errors;
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    // Copy the error text if it changed since seenVersion
+    bool fetch(unsigned int& seenVersion, std::string& errors) {
+        if (version.load(std::memory_order_acquire) == seenVersion)
+            return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        errors = text;
+        seenVersion = version.load(std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    std::string text;
+    std::atomic<unsigned int> version{0};
+};
+
+// Rebuilds shader programs without stalling the render thread.
+//
+// reload() reads the sources and issues compile and link, then update() checks
+// once per frame whether the driver has finished. With
+// GL_KHR_parallel_shader_compile that check is GL_COMPLETION_STATUS_KHR, which
+// never blocks; without it the status query is deferred by a frame so drivers
+// that compile on their own threads still get a head start. A program that
+// links replaces the old one between frames; one that fails is deleted and
+// the old program keeps rendering.
+class ShaderReloader {
+public:
+    explicit ShaderReloader(ShaderReloadStatus* status) : status(status) {
+#ifdef GL_KHR_parallel_shader_compile
+        parallelCompile = GLAD_GL_KHR_parallel_shader_compile != 0;
+        if (parallelCompile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);  // let the driver decide
+#endif
+    }
+
+    ~ShaderReloader() {
+        for (PendingBuild& build : pending)
+            discard(build);
+    }
+
+    ShaderReloader(const ShaderReloader&) = delete;
+    ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+    bool isParallel() const { return parallelCompile; }
+
+    // Start rebuilding target from its source files. setup runs on the new
+    // program before it is swapped in (sampler units, block bindings).
+    void reload(Shader& target, std::function<void(Shader&)> setup) {
+        if (pending.empty())
+            errors.clear();
+        build(target, std::move(setup));
+    }
+
+    // Like reload(), for a target that may not have a program yet (ID 0
+    // until it links). Keeps the errors of earlier builds on display.
+    void build(Shader& target, std::function<void(Shader&)> setup) {
+        for (size_t i = 0; i < pending.size(); i++) {
+            if (pending[i].target == &target) {
+                discard(pending[i]);
+                pending.erase(pending.begin() + i);
+                break;
+            }
+        }
+
+        PendingBuild build;
+        build.target = &target;
+        build.setup = std::move(setup);
+        build.program = target.startBuild(build.vertex, build.fragment);
+        pending.push_back(std::move(build));
+        status->pending.store((int)pending.size(), std::memory_order_relaxed);
+    }
+
+    // Swap in every program that finished linking. Call once per frame.
+    void update() {
+        if (pending.empty())
+            return;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < pending.size(); i++) {
+            PendingBuild& build = pending[i];
+            if (!isComplete(build)) {
+                if (kept != i)
+                    pending[kept] = std::move(build);
+                kept++;
+                continue;
+            }
+            finish(build);
+        }
+        pending.resize(kept);
+        status->pending.store((int)kept, std::memory_order_relaxed);
+        if (kept == 0)
+            status->publish(errors);
+    }
+
+private:
+    struct PendingBuild {
+        Shader* target = nullptr;
+        std::function<void(Shader&)> setup;
+        unsigned int vertex = 0;
+        unsigned int fragment = 0;
+        unsigned int program = 0;
+        int framesWaited = 0;
+    };
+
+    ShaderReloadStatus* status;
+    std::vector<PendingBuild> pending;
+    std::string errors;  // accumulated over the current batch of reloads
+    bool parallelCompile = false;
+
+    bool isComplete(PendingBuild& build) {
+#ifdef GL_KHR_parallel_shader_compile
+        if (parallelCompile) {
+            GLint done = GL_FALSE;
+            glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &done);
+            return done != GL_FALSE;
+        }
+#endif
+        return build.framesWaited++ >= 1;
+    }
+
+    void finish(PendingBuild& build) {
+        std::string log;
+        bool vertexOk = Shader::checkCompileErrors(build.vertex, "VERTEX", &log);
+        bool fragmentOk = Shader::checkCompileErrors(build.fragment, "FRAGMENT", &log);
+        bool linked = vertexOk && fragmentOk && Shader::checkCompileErrors(build.program, "PROGRAM", &log);
+        glDeleteShader(build.vertex);
+        glDeleteShader(build.fragment);
+
+        if (!linked) {
+            errors += build.target->vertexPath + " + " + build.target->fragmentPath + ":\n" + log;
+            glDeleteProgram(build.program);
+            return;
+        }
+
+        build.target->replaceProgram(build.program);
+        if (build.setup)
+            build.setup(*build.target);
+        status->reloads.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void discard(PendingBuild& build) {
+        glDeleteShader(build.vertex);
+        glDeleteShader(build.fragment);
+        glDeleteProgram(build.program);
+    }
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#endif
+
+// Watches the shader directory for saved .vert/.frag files (UI thread).
+//
+// On Linux this is a non-blocking inotify descriptor drained once per frame.
+// Editors often save in several steps (write a temp file, rename, touch), so
+// changes are only reported after the directory has been quiet for
+// SETTLE_MS. Elsewhere the directory's modification times are polled.
+class ShaderWatcher {
+public:
+    static const int SETTLE_MS = 100;
+
+    explicit ShaderWatcher(const char* directory) : directory(directory) {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd >= 0 && inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd < 0)
+            std::cout << "ShaderWatcher: could not watch " << directory << ": " << std::strerror(errno) << "\n";
+#else
+        latestWrite = scanLatestWrite();
+#endif
+    }
+
+    ~ShaderWatcher() {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // True once per settled burst of shader changes
+    bool poll() {
+        Clock::time_point now = Clock::now();
+        if (readChanges(now)) {
+            dirty = true;
+            lastChange = now;
+        }
+        if (dirty && now - lastChange >= std::chrono::milliseconds(SETTLE_MS)) {
+            dirty = false;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    std::string directory;
+    bool dirty = false;
+    Clock::time_point lastChange;
+
+    static bool isShaderFile(const char* name) {
+        const char* extension = std::strrchr(name, '.');
+        return extension != nullptr && (std::strcmp(extension, ".vert") == 0 || std::strcmp(extension, ".frag") == 0);
+    }
+
+#ifdef __linux__
+    int fd = -1;
+
+    bool readChanges(Clock::time_point) {
+        if (fd < 0)
+            return false;
+        bool changed = false;
+        alignas(struct inotify_event) char buffer[4096];
+        while (true) {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;  // EAGAIN: nothing left to read
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                const struct inotify_event* event = (const struct inotify_event*)ptr;
+                if (event->len > 0 && isShaderFile(event->name))
+                    changed = true;
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return changed;
+    }
+#else
+    static const int POLL_MS = 500;
+
+    std::filesystem::file_time_type latestWrite;
+    Clock::time_point lastScan;
+
+    std::filesystem::file_time_type scanLatestWrite() const {
+        std::filesystem::file_time_type latest = std::filesystem::file_time_type::min();
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            if (!isShaderFile(entry.path().filename().string().c_str()))
+                continue;
+            std::filesystem::file_time_type written = entry.last_write_time(error);
+            if (!error && written > latest)
+                latest = written;
+        }
+        return latest;
+    }
+
+    bool readChanges(Clock::time_point now) {
+        if (now - lastScan < std::chrono::milliseconds(POLL_MS))
+            return false;
+        lastScan = now;
+        std::filesystem::file_time_type latest = scanLatestWrite();
+        if (latest == latestWrite)
+            return false;
+        latestWrite = latest;
+        return true;
+    }
+#endif
+};
+
+#endif
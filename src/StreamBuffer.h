@@ -0,0 +1,174 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+// Number of frames the ring is split into. The CPU writes region N while
+// the GPU may still be reading regions N-1 and N-2.
+const int STREAM_BUFFER_FRAMES = 3;
+
+// Ring buffer for per-frame dynamic data (uniform blocks, later vertex data).
+//
+// With GL 4.4 / ARB_buffer_storage the whole buffer is created immutable and
+// mapped once with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT, so uploads are
+// plain memcpys. Otherwise each frame's region is mapped unsynchronized and
+// unmapped in commit(). Either way a fence per region guards reuse, so the
+// driver never has to synchronize on our behalf.
+//
+// Per frame:
+//   beginFrame()  wait for this region's fence, map it if needed
+//   allocate()    sub-allocate and write the frame's data
+//   commit()      unmap (fallback path only) before any draw reads the data
+//   bindRange()   bind sub-allocations with glBindBufferRange
+//   endFrame()    fence the region
+class StreamBuffer {
+public:
+    unsigned int ID = 0;
+
+    // Counters for the last completed frame
+    size_t uploadBytes = 0;      // bytes written by allocate()
+    float fenceWaitMs = 0.0f;    // time blocked on the region's fence
+    unsigned int fenceWaits = 0; // total frames that had to wait
+
+    StreamBuffer(GLenum target, GLsizeiptr bytesPerFrame)
+        : target(target), regionSize(bytesPerFrame) {
+        GLint offsetAlignment = 256;
+        if (target == GL_UNIFORM_BUFFER)
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+        alignment = offsetAlignment > 0 ? offsetAlignment : 1;
+        regionSize = alignUp(regionSize);
+
+        GLsizeiptr totalSize = regionSize * STREAM_BUFFER_FRAMES;
+        glGenBuffers(1, &ID);
+        glBindBuffer(target, ID);
+#ifdef GL_MAP_PERSISTENT_BIT
+        if (glBufferStorage != NULL) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(target, totalSize, NULL, flags);
+            persistentBase = (char*)glMapBufferRange(target, 0, totalSize, flags);
+        }
+#endif
+        if (persistentBase == nullptr) {
+            glBufferData(target, totalSize, NULL, GL_STREAM_DRAW);
+            std::cout << "StreamBuffer: persistent mapping unavailable, using unsynchronized maps\n";
+        }
+        glBindBuffer(target, 0);
+    }
+
+    ~StreamBuffer() {
+        for (int i = 0; i < STREAM_BUFFER_FRAMES; i++) {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+        }
+        if (persistentBase != nullptr) {
+            glBindBuffer(target, ID);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+        }
+        glDeleteBuffers(1, &ID);
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    bool isPersistent() const { return persistentBase != nullptr; }
+    GLsizeiptr capacityPerFrame() const { return regionSize; }
+
+    void beginFrame() {
+        region = frameCounter % STREAM_BUFFER_FRAMES;
+        waitForRegion();
+
+        regionOffset = 0;
+        uploadedThisFrame = 0;
+        if (persistentBase != nullptr) {
+            mapped = persistentBase + region * regionSize;
+        } else {
+            glBindBuffer(target, ID);
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+            mapped = (char*)glMapBufferRange(target, region * regionSize, regionSize, flags);
+            glBindBuffer(target, 0);
+        }
+    }
+
+    // Reserve size bytes in this frame's region. Returns a write pointer and
+    // the offset to pass to bindRange(), or nullptr if the region is full.
+    void* allocate(GLsizeiptr size, GLintptr* offset) {
+        if (mapped == nullptr || regionOffset + size > regionSize)
+            return nullptr;
+        void* ptr = mapped + regionOffset;
+        *offset = region * regionSize + regionOffset;
+        regionOffset += alignUp(size);
+        uploadedThisFrame += (size_t)size;
+        return ptr;
+    }
+
+    template <typename T>
+    T* allocate(GLintptr* offset) {
+        return (T*)allocate(sizeof(T), offset);
+    }
+
+    // Make this frame's writes visible to the GL. Must happen before drawing.
+    void commit() {
+        if (persistentBase == nullptr && mapped != nullptr) {
+            glBindBuffer(target, ID);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+        }
+        mapped = nullptr;
+    }
+
+    void bindRange(GLuint index, GLintptr offset, GLsizeiptr size) const {
+        glBindBufferRange(target, index, ID, offset, size);
+    }
+
+    void endFrame() {
+        commit();
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        uploadBytes = uploadedThisFrame;
+        frameCounter++;
+    }
+
+private:
+    GLenum target;
+    GLsizeiptr regionSize;
+    GLsizeiptr alignment = 256;
+    char* persistentBase = nullptr;
+    char* mapped = nullptr;
+    GLsync fences[STREAM_BUFFER_FRAMES] = {};
+    unsigned int frameCounter = 0;
+    int region = 0;
+    GLsizeiptr regionOffset = 0;
+    size_t uploadedThisFrame = 0;
+
+    GLsizeiptr alignUp(GLsizeiptr size) const {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    // Block until the GPU has finished reading the region we're about to reuse
+    void waitForRegion() {
+        fenceWaitMs = 0.0f;
+        GLsync fence = fences[region];
+        if (!fence)
+            return;
+
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            fenceWaits++;
+            auto start = std::chrono::steady_clock::now();
+            do {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+            } while (result == GL_TIMEOUT_EXPIRED);
+            fenceWaitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (result == GL_WAIT_FAILED)
+            std::cout << "ERROR::STREAM_BUFFER: fence wait failed\n";
+
+        glDeleteSync(fence);
+        fences[region] = 0;
+    }
+};
+
+#endif
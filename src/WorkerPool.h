@@ -0,0 +1,111 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. parallelFor() hands
+// out task indices through an atomic counter; the calling thread works on
+// tasks too and returns once all of them have finished. One loop at a time.
+class WorkerPool {
+public:
+    explicit WorkerPool(int workerThreads) {
+        for (int i = 0; i < workerThreads; i++)
+            threads.emplace_back(&WorkerPool::workerMain, this, i + 1);
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Threads that take part in a loop, including the caller (worker 0)
+    int size() const { return (int)threads.size() + 1; }
+
+    // Run task(index, worker) for every index in [0, count)
+    void parallelFor(int count, const std::function<void(int, int)>& task) {
+        if (count <= 0)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &task;
+            jobCount = count;
+            nextTask.store(0, std::memory_order_relaxed);
+            remaining.store(count, std::memory_order_relaxed);
+            generation++;
+        }
+        wake.notify_all();
+
+        runTasks(task, count, 0);
+
+        // Also wait for workers that are still inside runTasks(), so none of
+        // them can pick up an index of the next loop with this loop's task
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining.load(std::memory_order_acquire) == 0 && active == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int, int)>* job = nullptr;
+    int jobCount = 0;
+    unsigned int generation = 0;
+    int active = 0;
+    bool stopping = false;
+    std::atomic<int> nextTask{0};
+    std::atomic<int> remaining{0};
+
+    void workerMain(int worker) {
+        unsigned int seen = 0;
+        while (true) {
+            const std::function<void(int, int)>* task;
+            int count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || (generation != seen && job != nullptr); });
+                if (stopping)
+                    return;
+                seen = generation;
+                task = job;
+                count = jobCount;
+                active++;
+            }
+            runTasks(*task, count, worker);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active--;
+            }
+            done.notify_all();
+        }
+    }
+
+    void runTasks(const std::function<void(int, int)>& task, int count, int worker) {
+        while (true) {
+            int index = nextTask.fetch_add(1, std::memory_order_relaxed);
+            if (index >= count)
+                return;
+            task(index, worker);
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+};
+
+#endif
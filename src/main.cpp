@@ -6,9 +6,34 @@
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include "AllocationCounter.h"
 #include "Shader.h"
+#include "ShaderPermutations.h"
+#include "ShaderReloader.h"
+#include "ShaderWatcher.h"
 #include "Camera.h"
+#include "InputRecorder.h"
+#include "FrameSnapshot.h"
+#include "StreamBuffer.h"
+#include "GpuTimer.h"
+#include "DynamicResolution.h"
+#include "PrepassBenchmark.h"
+#include "OcclusionCuller.h"
+#include "OcclusionBenchmark.h"
+#include "FrameCapture.h"
+
+// Shader directory: the source tree's when the build sets it (see
+// ENGINE_SOURCE_SHADERS), so edits there hot-reload; shaders/ next to the
+// working directory otherwise
+#ifndef ENGINE_SHADER_DIR
+#define ENGINE_SHADER_DIR "shaders"
+#endif
 
 // Settings
 unsigned int SCR_WIDTH = 1280;
@@ -22,6 +47,8 @@ float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
+float simulationTime = 0.0f;  // drives animation; fixed steps while recording or replaying
+glm::vec2 mouseDelta(0.0f);   // cursor movement since the last frame
 bool showUI = true;
 bool cameraLocked = false;
 
@@ -61,6 +88,40 @@ float depthFar = 100.0f;
 bool showShadowMapOverlay = false;
 float overlaySize = 0.25f; // Size of overlay (0.0 to 1.0)
 
+// Dynamic resolution: the lit pass renders offscreen at a scale chosen to
+// keep the GPU frame time within budget, then gets upscaled to the window
+bool dynamicResolution = true;
+float targetFrameMs = 16.6f;
+float minResolutionScale = 0.5f;
+float upscaleSharpness = 0.5f;
+
+// Depth prepass: lay down camera depth first, then shade with GL_EQUAL so
+// each pixel runs shadow.frag once. Overdraw layers add rows of cubes
+// (submitted back to front) to stress it.
+bool depthPrepass = false;
+int overdrawLayers = 0;
+PrepassBenchmark prepassBenchmark;
+
+// CPU occlusion culling: objects hidden behind others are left out of the
+// prepass and lit pass. The shadow pass still draws everything.
+bool occlusionCulling = false;
+OcclusionBenchmark occlusionBenchmark;
+
+// Multi-view: extra cameras on a circle around the scene, each rendered into
+// a tile of one target by instancing every draw once per view
+int multiViewCount = 0;
+float multiViewDistance = 9.0f;
+float multiViewHeight = 4.0f;
+glm::vec3 multiViewTarget(0.0f, 0.5f, 0.0f);
+
+// Frame capture: the finished frame and/or the shadow map are read back
+// asynchronously and written to CAPTURE_DIRECTORY by encoder threads
+const char* CAPTURE_DIRECTORY = "captures";
+int captureColorFormat = CAPTURE_PNG;
+int captureDepthFormat = CAPTURE_OFF;
+bool captureContinuous = false;
+bool captureFrameRequested = false;
+
 // Additional objects
 bool showSecondCube = true;
 glm::vec3 cube2Position(-3.0f, 0.5f, 2.0f);
@@ -80,8 +141,25 @@ float lightLinear = 0.09f;
 float lightQuadratic = 0.032f;
 glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
 
+// Threading
+bool reloadShadersRequested = false;
+bool autoReloadShaders = true;  // reload when files in shaders/ are saved
+ThreadTimings threadTimings;
+RenderStats renderStats;
+ShaderReloadStatus shaderReloadStatus;
+
+// Recording: camera input and parameter edits are logged per frame so a run
+// can be replayed exactly (see InputRecorder.h)
+const char* RECORDING_PATH = "recording.bin";
+InputRecorder recorder;
+
+// Runs on the UI thread, which doesn't own the GL context. The new size
+// reaches the render thread through the next frame snapshot.
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
+    if (width > 0 && height > 0) {
+        SCR_WIDTH = width;
+        SCR_HEIGHT = height;
+    }
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
@@ -101,7 +179,8 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     lastX = (float)xpos;
     lastY = (float)ypos;
     
-    camera.ProcessMouseMovement(xoffset, yoffset);
+    // Applied once per frame in the main loop, so it can be recorded
+    mouseDelta += glm::vec2(xoffset, yoffset);
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
@@ -119,7 +198,12 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
     }
 }
 
-void processInput(GLFWwindow *window) {
+// Handles the UI toggles and returns this frame's camera input
+FrameInput processInput(GLFWwindow *window) {
+    FrameInput input;
+    input.mouse = mouseDelta;
+    mouseDelta = glm::vec2(0.0f);
+
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
     
@@ -152,14 +236,85 @@ void processInput(GLFWwindow *window) {
     
     if (!cameraLocked && (!showUI || !ImGui::GetIO().WantCaptureKeyboard)) {
         if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-            camera.ProcessKeyboard('W', deltaTime);
+            input.keys |= KEY_FORWARD;
         if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-            camera.ProcessKeyboard('S', deltaTime);
+            input.keys |= KEY_BACKWARD;
         if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-            camera.ProcessKeyboard('A', deltaTime);
+            input.keys |= KEY_LEFT;
         if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-            camera.ProcessKeyboard('D', deltaTime);
+            input.keys |= KEY_RIGHT;
     }
+    return input;
+}
+
+void applyCameraInput(const FrameInput& input) {
+    if (input.keys & KEY_FORWARD)
+        camera.ProcessKeyboard('W', deltaTime);
+    if (input.keys & KEY_BACKWARD)
+        camera.ProcessKeyboard('S', deltaTime);
+    if (input.keys & KEY_LEFT)
+        camera.ProcessKeyboard('A', deltaTime);
+    if (input.keys & KEY_RIGHT)
+        camera.ProcessKeyboard('D', deltaTime);
+    if (input.mouse.x != 0.0f || input.mouse.y != 0.0f)
+        camera.ProcessMouseMovement(input.mouse.x, input.mouse.y);
+}
+
+// Everything the UI can change that affects the rendered frames. The order is
+// the parameter id in recordings: append new ones at the end.
+void registerRecordedParams() {
+    recorder.addParam(&camera.Position);
+    recorder.addParam(&camera.MovementSpeed);
+    recorder.addParam(&camera.MouseSensitivity);
+    recorder.addParam(&cameraFOV);
+    recorder.addParam(&cameraNear);
+    recorder.addParam(&cameraFar);
+    recorder.addParam(&projectionType);
+    recorder.addParam(&orthoSize);
+    recorder.addParam(&lightType);
+    recorder.addParam(&lightPos);
+    recorder.addParam(&lightTarget);
+    recorder.addParam(&lightUp);
+    recorder.addParam(&lightColor);
+    recorder.addParam(&lightConstant);
+    recorder.addParam(&lightLinear);
+    recorder.addParam(&lightQuadratic);
+    recorder.addParam(&lightOrthoSize);
+    recorder.addParam(&lightNear);
+    recorder.addParam(&lightFar);
+    recorder.addParam(&animateLight);
+    recorder.addParam(&animateCube);
+    recorder.addParam(&animationSpeed);
+    recorder.addParam(&cubePosition);
+    recorder.addParam(&cubeRotation);
+    recorder.addParam(&cubeScale);
+    recorder.addParam(&cubeColor);
+    recorder.addParam(&showSecondCube);
+    recorder.addParam(&cube2Position);
+    recorder.addParam(&cube2Rotation);
+    recorder.addParam(&cube2Scale);
+    recorder.addParam(&cube2Color);
+    recorder.addParam(&floorColor);
+    recorder.addParam(&clearColor);
+    recorder.addParam(&ambientStrength);
+    recorder.addParam(&specularStrength);
+    recorder.addParam(&specularShininess);
+    recorder.addParam(&enableShadows);
+    recorder.addParam(&shadowBias);
+    recorder.addParam(&wireframeMode);
+    recorder.addParam(&dynamicResolution);
+    recorder.addParam(&targetFrameMs);
+    recorder.addParam(&minResolutionScale);
+    recorder.addParam(&upscaleSharpness);
+    recorder.addParam(&depthPrepass);
+    recorder.addParam(&overdrawLayers);
+    recorder.addParam(&occlusionCulling);
+    recorder.addParam(&multiViewCount);
+    recorder.addParam(&multiViewDistance);
+    recorder.addParam(&multiViewHeight);
+    recorder.addParam(&renderMode);
+    recorder.addParam(&showShadowMapOverlay);
+    recorder.addParam(&overlaySize);
 }
 
 unsigned int loadCubeVAO() {
@@ -268,7 +423,804 @@ unsigned int loadQuadVAO() {
     return VAO;
 }
 
-int main() {
+// Occluder geometry for the CPU culler: the cube and plane meshes above
+// reduced to their corners, counter-clockwise from outside like the VAOs
+const glm::vec3 cubeOccluderVertices[8] = {
+    glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f),
+    glm::vec3(-0.5f,  0.5f, -0.5f), glm::vec3(0.5f,  0.5f, -0.5f),
+    glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(0.5f, -0.5f,  0.5f),
+    glm::vec3(-0.5f,  0.5f,  0.5f), glm::vec3(0.5f,  0.5f,  0.5f),
+};
+const uint16_t cubeOccluderIndices[36] = {
+    4, 5, 7,  4, 7, 6,  // +z
+    1, 0, 2,  1, 2, 3,  // -z
+    5, 1, 3,  5, 3, 7,  // +x
+    0, 4, 6,  0, 6, 2,  // -x
+    6, 7, 3,  6, 3, 2,  // +y
+    0, 1, 5,  0, 5, 4,  // -y
+};
+const glm::vec3 planeOccluderVertices[4] = {
+    glm::vec3(-25.0f, -0.5f, -25.0f), glm::vec3(25.0f, -0.5f, -25.0f),
+    glm::vec3( 25.0f, -0.5f,  25.0f), glm::vec3(-25.0f, -0.5f, 25.0f),
+};
+const uint16_t planeOccluderIndices[6] = { 3, 2, 1,  3, 1, 0 };
+
+const OccluderMesh cubeOccluder = { cubeOccluderVertices, 8, cubeOccluderIndices, 12,
+                                    glm::vec3(-0.5f), glm::vec3(0.5f) };
+const OccluderMesh planeOccluder = { planeOccluderVertices, 4, planeOccluderIndices, 2,
+                                     glm::vec3(-25.0f, -0.5f, -25.0f), glm::vec3(25.0f, -0.5f, 25.0f) };
+
+const OccluderMesh& occluderMesh(MeshType mesh) {
+    return mesh == MESH_PLANE ? planeOccluder : cubeOccluder;
+}
+
+// Worker threads for CPU-side parallel work, leaving a core each for the UI
+// and render threads (which also takes part in the work)
+int workerThreadCount() {
+    int cores = (int)std::thread::hardware_concurrency();
+    return std::max(1, cores - 2);
+}
+
+glm::mat4 objectModel(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale) {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, position);
+    model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(model, scale);
+    return model;
+}
+
+float millisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+// Uniform buffer binding points shared by all programs
+const unsigned int FRAME_BLOCK_BINDING = 0;
+const unsigned int OBJECT_BLOCK_BINDING = 1;
+const unsigned int VIEW_BLOCK_BINDING = 2;
+const GLsizeiptr UNIFORM_STREAM_SIZE = 1024 * 1024; // per frame
+
+// std140 mirror of FrameBlock in shadow.vert/shadow.frag
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::mat4 viewProjection;
+    glm::mat4 lightSpaceMatrix;
+    glm::vec4 viewPos;
+    glm::vec4 lightPos;
+    int lightType;
+    float constant;
+    float linear;
+    float quadratic;
+    float ambientStrength;
+    float specularStrength;
+    int shininess;
+    float shadowBias;
+    int enableShadows;
+    float shadowMapScale;
+    float padding[2];
+};
+
+// std140 mirror of ObjectBlock
+struct ObjectUniforms {
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// std140 mirror of ViewBlock in shadow.vert
+struct ViewUniforms {
+    glm::mat4 viewProjections[MAX_VIEWS];
+    glm::vec4 viewPositions[MAX_VIEWS];
+    glm::vec4 viewRects[MAX_VIEWS];
+};
+
+// Multi-view target: square tiles in a grid, view 0 top left
+const int MULTI_VIEW_TILE = 256;
+const int MULTI_VIEW_COLUMNS = 4;
+const int MULTI_VIEW_SIZE = MULTI_VIEW_TILE * MULTI_VIEW_COLUMNS;
+
+// Feature bits of the lit shader permutations; see shadow.vert/shadow.frag
+enum LitShaderFeature {
+    LIT_POINT_LIGHT = 1 << 0,
+    LIT_SHADOWS = 1 << 1,
+    LIT_MULTI_VIEW = 1 << 2,
+    LIT_VIEWPORT_ARRAY = 1 << 3,
+};
+
+unsigned int litShaderFeatures(const FrameSnapshot& frame) {
+    unsigned int features = 0;
+    if (frame.lightType == 1)
+        features |= LIT_POINT_LIGHT;
+    if (frame.enableShadows)
+        features |= LIT_SHADOWS;
+    return features;
+}
+
+// Sampler unit and uniform block bindings for a freshly compiled lit variant
+void setupLitShader(Shader& shader) {
+    shader.use();
+    shader.setInt("shadowMap", 0);
+    shader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+    shader.bindUniformBlock("ObjectBlock", OBJECT_BLOCK_BINDING);
+    shader.bindUniformBlock("ViewBlock", VIEW_BLOCK_BINDING);
+}
+
+// GL objects. Created on the main thread, then owned by the render thread.
+struct RenderContext {
+    Shader depthShader;
+    ShaderPermutations litShaders;  // shadow.vert/shadow.frag variants
+    Shader debugDepthShader;
+    Shader upscaleShader;
+    unsigned int depthMapFBO = 0;
+    unsigned int depthMap = 0;
+    unsigned int cubeVAO = 0;
+    unsigned int planeVAO = 0;
+    unsigned int quadVAO = 0;
+    std::unique_ptr<StreamBuffer> uniformStream;
+    FrameArena frameArena;  // render-thread transient data
+
+    // Offscreen lit-pass target, allocated at window size
+    unsigned int sceneFBO = 0;
+    unsigned int sceneColor = 0;
+    unsigned int sceneDepth = 0;
+    int sceneTargetWidth = 0;
+    int sceneTargetHeight = 0;
+    std::unique_ptr<GpuTimer> frameTimer;
+    std::unique_ptr<GpuSpanTimer> multiViewTimer;  // inside frameTimer's span
+    std::unique_ptr<GpuQueryRing> litSamples;  // GL_SAMPLES_PASSED of the lit pass
+    DynamicResolution resolution;
+    std::unique_ptr<ShaderReloader> shaderReloader;
+    std::unique_ptr<OcclusionCuller> occlusionCuller;
+    std::unique_ptr<FrameCapture> capture;
+
+    // Multi-view target; viewportArray selects gl_ViewportIndex routing
+    unsigned int multiViewFBO = 0;
+    unsigned int multiViewColor = 0;
+    unsigned int multiViewDepth = 0;
+    bool viewportArray = false;
+
+    RenderContext()
+        : depthShader(ENGINE_SHADER_DIR "/depth.vert", ENGINE_SHADER_DIR "/depth.frag"),
+          litShaders(ENGINE_SHADER_DIR "/shadow.vert", ENGINE_SHADER_DIR "/shadow.frag", { "POINT_LIGHT", "ENABLE_SHADOWS", "MULTI_VIEW", "VIEWPORT_ARRAY" }, setupLitShader,
+                     LIT_POINT_LIGHT | LIT_SHADOWS),
+          debugDepthShader(ENGINE_SHADER_DIR "/debug_depth.vert", ENGINE_SHADER_DIR "/debug_depth.frag"),
+          upscaleShader(ENGINE_SHADER_DIR "/debug_depth.vert", ENGINE_SHADER_DIR "/upscale.frag") {}
+};
+
+// Copy the scene state the render thread needs into a snapshot (UI thread)
+void buildFrameSnapshot(FrameSnapshot& frame) {
+    frame.width = SCR_WIDTH;
+    frame.height = SCR_HEIGHT;
+
+    float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+    if (projectionType == 0) {
+        // Perspective projection
+        frame.projection = glm::perspective(glm::radians(cameraFOV), aspect, cameraNear, cameraFar);
+    } else {
+        // Orthographic projection
+        frame.projection = glm::ortho(-orthoSize * aspect, orthoSize * aspect, -orthoSize, orthoSize, cameraNear, cameraFar);
+    }
+    frame.view = camera.GetViewMatrix();
+    frame.viewProjection = frame.projection * frame.view;
+    frame.viewPos = camera.Position;
+
+    glm::mat4 lightProjection = glm::ortho(-lightOrthoSize, lightOrthoSize, -lightOrthoSize, lightOrthoSize, lightNear, lightFar);
+    glm::mat4 lightView = glm::lookAt(lightPos, lightTarget, lightUp);
+    frame.lightSpaceMatrix = lightProjection * lightView;
+    frame.lightPos = lightPos;
+    frame.lightType = lightType;
+    frame.lightConstant = lightConstant;
+    frame.lightLinear = lightLinear;
+    frame.lightQuadratic = lightQuadratic;
+    frame.lightNear = lightNear;
+    frame.lightFar = lightFar;
+
+    frame.ambientStrength = ambientStrength;
+    frame.specularStrength = specularStrength;
+    frame.shininess = specularShininess;
+    frame.shadowBias = shadowBias;
+    frame.enableShadows = enableShadows;
+    frame.clearColor = clearColor;
+    frame.wireframe = wireframeMode;
+    frame.renderMode = renderMode;
+    frame.showShadowMapOverlay = showShadowMapOverlay;
+    frame.overlaySize = overlaySize;
+    frame.depthPrepass = depthPrepass;
+    frame.occlusionCulling = occlusionCulling;
+    bool capturing = captureContinuous || captureFrameRequested;
+    frame.captureColor = capturing ? captureColorFormat : CAPTURE_OFF;
+    frame.captureDepth = capturing ? captureDepthFormat : CAPTURE_OFF;
+    // A replay's captures must be complete, so the replay waits for them
+    frame.captureWait = capturing && recorder.replaying();
+    captureFrameRequested = false;
+
+    frame.viewCount = std::min(multiViewCount, MAX_VIEWS);
+    glm::mat4 viewProjection = glm::perspective(glm::radians(50.0f), 1.0f, cameraNear, cameraFar);
+    for (int i = 0; i < frame.viewCount; i++) {
+        float angle = glm::radians(360.0f * i / frame.viewCount);
+        glm::vec3 eye = multiViewTarget + glm::vec3(std::cos(angle) * multiViewDistance, multiViewHeight, std::sin(angle) * multiViewDistance);
+        frame.viewProjections[i] = viewProjection * glm::lookAt(eye, multiViewTarget, glm::vec3(0.0f, 1.0f, 0.0f));
+        frame.viewPositions[i] = eye;
+    }
+    // Benchmarks need a fixed resolution
+    frame.dynamicResolution = dynamicResolution && !prepassBenchmark.running();
+    frame.targetFrameMs = targetFrameMs;
+    frame.minResolutionScale = minResolutionScale;
+    frame.upscaleSharpness = upscaleSharpness;
+    frame.reloadShaders = reloadShadersRequested;
+    reloadShadersRequested = false;
+
+    const int cubesPerLayer = 15;
+    frame.beginFrame(3 + overdrawLayers * cubesPerLayer);
+
+    // Overdraw layers: walls of cubes behind the scene, farthest first so
+    // that without a prepass every layer gets shaded
+    for (int layer = overdrawLayers - 1; layer >= 0; layer--) {
+        float z = -3.0f - 1.5f * layer;
+        glm::vec3 color(0.3f + 0.7f * (layer % 3) / 2.0f, 0.4f, 0.9f - 0.6f * (layer % 4) / 3.0f);
+        for (int i = 0; i < cubesPerLayer; i++) {
+            glm::vec3 position(-8.0f + 4.0f * (i % 5), 1.0f + 3.0f * (i / 5), z);
+            frame.addObject(MESH_CUBE, objectModel(position, glm::vec3(0.0f), glm::vec3(3.8f, 2.8f, 1.0f)), color);
+        }
+    }
+
+    frame.addObject(MESH_PLANE, glm::mat4(1.0f), floorColor);
+    frame.addObject(MESH_CUBE, objectModel(cubePosition, cubeRotation, cubeScale), cubeColor);
+    if (showSecondCube) {
+        frame.addObject(MESH_CUBE, objectModel(cube2Position, cube2Rotation, cube2Scale), cube2Color);
+    }
+}
+
+// Sampler units and uniform block bindings; needed again after every reload
+void setupDepthShader(Shader& shader) {
+    shader.bindUniformBlock("ObjectBlock", OBJECT_BLOCK_BINDING);
+}
+
+void setupDebugDepthShader(Shader& shader) {
+    shader.use();
+    shader.setInt("depthMap", 0);
+}
+
+void setupUpscaleShader(Shader& shader) {
+    shader.use();
+    shader.setInt("sceneColor", 0);
+}
+
+void setupShaders(RenderContext& ctx) {
+    setupDepthShader(ctx.depthShader);
+    setupDebugDepthShader(ctx.debugDepthShader);
+    setupUpscaleShader(ctx.upscaleShader);
+}
+
+// Rebuild every program in the background; the current ones keep rendering
+// until their replacements have linked
+void reloadShaders(RenderContext& ctx) {
+    ShaderReloader& reloader = *ctx.shaderReloader;
+    reloader.reload(ctx.depthShader, setupDepthShader);
+    reloader.reload(ctx.debugDepthShader, setupDebugDepthShader);
+    reloader.reload(ctx.upscaleShader, setupUpscaleShader);
+    for (int features = 0; features < ctx.litShaders.variantCount(); features++) {
+        if (Shader* variant = ctx.litShaders.compiled(features))
+            reloader.reload(*variant, setupLitShader);
+    }
+}
+
+// (Re)create the offscreen lit-pass target at window size. Render scales
+// below 1 only shrink the viewport, so this runs on resize, not per frame.
+void resizeSceneTarget(RenderContext& ctx, int width, int height) {
+    if (ctx.sceneFBO != 0 && ctx.sceneTargetWidth == width && ctx.sceneTargetHeight == height)
+        return;
+    if (ctx.sceneFBO == 0) {
+        glGenFramebuffers(1, &ctx.sceneFBO);
+        glGenTextures(1, &ctx.sceneColor);
+        glGenRenderbuffers(1, &ctx.sceneDepth);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, ctx.sceneColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.sceneDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.sceneFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ctx.sceneColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ctx.sceneDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Scene target is not complete\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    ctx.sceneTargetWidth = width;
+    ctx.sceneTargetHeight = height;
+}
+
+// Fixed-size target for the multi-view pass. Views are routed to their tiles
+// with gl_ViewportIndex from the vertex shader when the driver supports
+// ARB_shader_viewport_layer_array, else by remapping clip space per instance.
+void createMultiViewTarget(RenderContext& ctx) {
+    glGenFramebuffers(1, &ctx.multiViewFBO);
+    glGenTextures(1, &ctx.multiViewColor);
+    glGenRenderbuffers(1, &ctx.multiViewDepth);
+
+    glBindTexture(GL_TEXTURE_2D, ctx.multiViewColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, MULTI_VIEW_SIZE, MULTI_VIEW_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.multiViewDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, MULTI_VIEW_SIZE, MULTI_VIEW_SIZE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.multiViewFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ctx.multiViewColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ctx.multiViewDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Multi-view target is not complete\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+#ifdef GL_ARB_shader_viewport_layer_array
+    ctx.viewportArray = GLAD_GL_ARB_shader_viewport_layer_array && glViewportIndexedf != NULL;
+#endif
+}
+
+// Lower-left corner of a view's tile in the multi-view target
+glm::ivec2 multiViewTileOrigin(int view) {
+    int column = view % MULTI_VIEW_COLUMNS;
+    int row = view / MULTI_VIEW_COLUMNS;
+    return glm::ivec2(column * MULTI_VIEW_TILE, (MULTI_VIEW_COLUMNS - 1 - row) * MULTI_VIEW_TILE);
+}
+
+// Write this frame's uniform blocks into the stream buffer. Per-object
+// offsets are appended to objectOffsets (-1 if the ring ran out of space).
+void uploadFrameUniforms(RenderContext& ctx, const FrameSnapshot& frame, float shadowScale, GLintptr* frameOffset, FrameVector<GLintptr>& objectOffsets) {
+    StreamBuffer& stream = *ctx.uniformStream;
+
+    FrameUniforms uniforms;
+    uniforms.projection = frame.projection;
+    uniforms.view = frame.view;
+    uniforms.viewProjection = frame.viewProjection;
+    uniforms.lightSpaceMatrix = frame.lightSpaceMatrix;
+    uniforms.viewPos = glm::vec4(frame.viewPos, 1.0f);
+    uniforms.lightPos = glm::vec4(frame.lightPos, 1.0f);
+    uniforms.lightType = frame.lightType;
+    uniforms.constant = frame.lightConstant;
+    uniforms.linear = frame.lightLinear;
+    uniforms.quadratic = frame.lightQuadratic;
+    uniforms.ambientStrength = frame.ambientStrength;
+    uniforms.specularStrength = frame.specularStrength;
+    uniforms.shininess = frame.shininess;
+    uniforms.shadowBias = frame.shadowBias;
+    uniforms.enableShadows = frame.enableShadows ? 1 : 0;
+    uniforms.shadowMapScale = shadowScale;
+
+    // Only ever write to the mapped pointers; they may be write-combined
+    *frameOffset = -1;
+    if (FrameUniforms* dst = stream.allocate<FrameUniforms>(frameOffset))
+        *dst = uniforms;
+
+    objectOffsets.reserve(frame.objects.size());
+    for (const ObjectSnapshot& source : frame.objects) {
+        ObjectUniforms object;
+        object.model = source.model;
+        object.color = glm::vec4(source.color, 1.0f);
+        GLintptr offset = -1;
+        if (ObjectUniforms* dst = stream.allocate<ObjectUniforms>(&offset))
+            *dst = object;
+        objectOffsets.push_back(offset);
+    }
+}
+
+// Camera and tile of every multi-view view; viewOffset is -1 if the ring is full
+void uploadViewUniforms(RenderContext& ctx, const FrameSnapshot& frame, GLintptr* viewOffset) {
+    ViewUniforms uniforms;
+    float scale = (float)MULTI_VIEW_TILE / MULTI_VIEW_SIZE;
+    for (int i = 0; i < frame.viewCount; i++) {
+        glm::ivec2 origin = multiViewTileOrigin(i);
+        uniforms.viewProjections[i] = frame.viewProjections[i];
+        uniforms.viewPositions[i] = glm::vec4(frame.viewPositions[i], 1.0f);
+        // NDC scale and offset that map the view's clip volume onto its tile
+        uniforms.viewRects[i] = glm::vec4(scale, scale,
+                                          -1.0f + 2.0f * (origin.x + 0.5f * MULTI_VIEW_TILE) / MULTI_VIEW_SIZE,
+                                          -1.0f + 2.0f * (origin.y + 0.5f * MULTI_VIEW_TILE) / MULTI_VIEW_SIZE);
+    }
+
+    *viewOffset = -1;
+    if (ViewUniforms* dst = ctx.uniformStream->allocate<ViewUniforms>(viewOffset))
+        *dst = uniforms;
+}
+
+// Order object indices front to back from the camera, by object origin
+void sortFrontToBack(const FrameSnapshot& frame, FrameVector<float>& distances, FrameVector<uint32_t>& order) {
+    distances.reserve(frame.objects.size());
+    order.reserve(frame.objects.size());
+    for (size_t i = 0; i < frame.objects.size(); i++) {
+        glm::vec3 toObject = glm::vec3(frame.objects[i].model[3]) - frame.viewPos;
+        distances.push_back(glm::dot(toObject, toObject));
+        order.push_back((uint32_t)i);
+    }
+    std::sort(order.begin(), order.end(), [&distances](uint32_t a, uint32_t b) {
+        return distances[a] < distances[b];
+    });
+}
+
+// Drop objects hidden behind others from the lit pass. The scene is
+// rasterized on the CPU with this frame's matrices, so there is no GPU
+// readback latency. order is filtered in place, or filled if it's empty.
+void cullOccluded(RenderContext& ctx, const FrameSnapshot& frame, FrameVector<uint32_t>& order) {
+    LinearArena& arena = ctx.frameArena.get();
+    size_t count = frame.objects.size();
+    FrameVector<OcclusionInstance> instances((ArenaAllocator<OcclusionInstance>(&arena)));
+    FrameVector<uint8_t> visible(count, 0, ArenaAllocator<uint8_t>(&arena));
+    instances.reserve(count);
+    for (const ObjectSnapshot& object : frame.objects) {
+        OcclusionInstance instance;
+        instance.model = object.model;
+        instance.mesh = &occluderMesh(object.mesh);
+        instances.push_back(instance);
+    }
+
+    OcclusionCuller& culler = *ctx.occlusionCuller;
+    culler.cull(frame.viewProjection, instances.data(), count, visible.data());
+
+    if (order.empty()) {
+        order.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            if (visible[i])
+                order.push_back((uint32_t)i);
+        }
+    } else {
+        order.erase(std::remove_if(order.begin(), order.end(), [&visible](uint32_t i) { return !visible[i]; }), order.end());
+    }
+
+    renderStats.occlusionCulled.store(culler.stats.culled, std::memory_order_relaxed);
+    renderStats.occlusionTriangles.store(culler.stats.triangles, std::memory_order_relaxed);
+    renderStats.occlusionMs.store(culler.stats.setupMs + culler.stats.rasterMs + culler.stats.testMs, std::memory_order_relaxed);
+}
+
+// Draw every object in the snapshot, binding its slice of the uniform stream.
+// Objects are drawn in snapshot order unless an explicit order is given.
+void drawObjects(RenderContext& ctx, const FrameSnapshot& frame, const FrameVector<GLintptr>& objectOffsets,
+                 const FrameVector<uint32_t>* order = nullptr, int instances = 1) {
+    for (size_t n = 0; n < frame.objects.size(); n++) {
+        size_t i = order ? (*order)[n] : n;
+        const ObjectSnapshot& object = frame.objects[i];
+        if (objectOffsets[i] < 0)
+            continue;
+        ctx.uniformStream->bindRange(OBJECT_BLOCK_BINDING, objectOffsets[i], sizeof(ObjectUniforms));
+        if (object.mesh == MESH_PLANE) {
+            glBindVertexArray(ctx.planeVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, instances);
+        } else {
+            glBindVertexArray(ctx.cubeVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, instances);
+        }
+    }
+}
+
+// Render every multi-view view in one pass: each object is drawn once,
+// instanced per view, with the shadow map and uniforms of the main view
+void renderMultiView(RenderContext& ctx, const FrameSnapshot& frame, const FrameVector<GLintptr>& objectOffsets, GLintptr viewOffset) {
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.multiViewFBO);
+    glViewport(0, 0, MULTI_VIEW_SIZE, MULTI_VIEW_SIZE);
+    glClearColor(frame.clearColor.r, frame.clearColor.g, frame.clearColor.b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    unsigned int features = litShaderFeatures(frame) | LIT_MULTI_VIEW;
+    if (ctx.viewportArray) {
+        features |= LIT_VIEWPORT_ARRAY;
+        for (int i = 0; i < frame.viewCount; i++) {
+            glm::ivec2 origin = multiViewTileOrigin(i);
+            glViewportIndexedf(i, (float)origin.x, (float)origin.y, (float)MULTI_VIEW_TILE, (float)MULTI_VIEW_TILE);
+        }
+    } else {
+        for (int i = 0; i < 4; i++)
+            glEnable(GL_CLIP_DISTANCE0 + i);
+    }
+
+    // Left cleared while the multi-view variant is still compiling
+    if (Shader* shader = ctx.litShaders.get(features, *ctx.shaderReloader)) {
+        ctx.uniformStream->bindRange(VIEW_BLOCK_BINDING, viewOffset, sizeof(ViewUniforms));
+        shader->use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, ctx.depthMap);
+        drawObjects(ctx, frame, objectOffsets, nullptr, frame.viewCount);
+    }
+
+    if (!ctx.viewportArray) {
+        for (int i = 0; i < 4; i++)
+            glDisable(GL_CLIP_DISTANCE0 + i);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, frame.width, frame.height);  // also resets every indexed viewport
+}
+
+// Issue all GL work for one frame (render thread)
+void renderFrame(RenderContext& ctx, const FrameSnapshot& frame) {
+    if (frame.reloadShaders)
+        reloadShaders(ctx);
+    ctx.shaderReloader->update();
+
+    ctx.frameArena.beginFrame();
+    ArenaAllocator<GLintptr> arena(&ctx.frameArena.get());
+
+    // Pick this frame's render scale from GPU times measured a few frames ago
+    if (ctx.frameTimer->poll() && frame.dynamicResolution)
+        ctx.resolution.update(ctx.frameTimer->lastMs(), frame.targetFrameMs, frame.minResolutionScale);
+    if (!frame.dynamicResolution)
+        ctx.resolution.reset();
+    float renderScale = ctx.resolution.scale;
+    float shadowScale = ctx.resolution.shadowScale();
+    int shadowWidth = (int)(SHADOW_WIDTH * shadowScale);
+    int shadowHeight = (int)(SHADOW_HEIGHT * shadowScale);
+    int sceneWidth = frame.width;
+    int sceneHeight = frame.height;
+    if (frame.dynamicResolution) {
+        resizeSceneTarget(ctx, frame.width, frame.height);
+        sceneWidth = std::max(1, (int)(frame.width * renderScale));
+        sceneHeight = std::max(1, (int)(frame.height * renderScale));
+    }
+
+    ctx.frameTimer->begin();
+
+    // Stream all per-frame and per-object uniforms up front
+    StreamBuffer& stream = *ctx.uniformStream;
+    GLintptr frameOffset;
+    FrameVector<GLintptr> objectOffsets(arena);
+    stream.beginFrame();
+    uploadFrameUniforms(ctx, frame, shadowScale, &frameOffset, objectOffsets);
+    GLintptr viewOffset = -1;
+    if (frame.viewCount > 0)
+        uploadViewUniforms(ctx, frame, &viewOffset);
+    stream.commit();
+    if (frameOffset >= 0)
+        stream.bindRange(FRAME_BLOCK_BINDING, frameOffset, sizeof(FrameUniforms));
+
+    // Enable/disable wireframe
+    if (frame.wireframe) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    } else {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+
+    // 1. Render depth of scene to texture (from light's perspective)
+    ctx.depthShader.use();
+    ctx.depthShader.setMat4("viewProjection", frame.lightSpaceMatrix);
+
+    glViewport(0, 0, shadowWidth, shadowHeight);
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.depthMapFBO);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    drawObjects(ctx, frame, objectOffsets);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // 2. Render scene as normal using the generated depth/shadow map
+    if (frame.dynamicResolution)
+        glBindFramebuffer(GL_FRAMEBUFFER, ctx.sceneFBO);
+    glViewport(0, 0, sceneWidth, sceneHeight);
+    glClearColor(frame.clearColor.r, frame.clearColor.g, frame.clearColor.b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Draw order of the camera passes: front to back for the prepass,
+    // minus whatever the CPU occlusion test rejected
+    FrameVector<uint32_t> order(ArenaAllocator<uint32_t>(&ctx.frameArena.get()));
+    if (frame.depthPrepass) {
+        FrameVector<float> distances(ArenaAllocator<float>(&ctx.frameArena.get()));
+        sortFrontToBack(frame, distances, order);
+    }
+    if (frame.occlusionCulling)
+        cullOccluded(ctx, frame, order);
+    const FrameVector<uint32_t>* drawOrder = frame.depthPrepass || frame.occlusionCulling ? &order : nullptr;
+
+    // 2a. Optional depth prepass, front to back so early-Z rejects as much
+    // as possible. The lit pass then only shades the visible fragment.
+    if (frame.depthPrepass) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        ctx.depthShader.use();
+        ctx.depthShader.setMat4("viewProjection", frame.viewProjection);
+        drawObjects(ctx, frame, objectOffsets, drawOrder);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    // 2b. Camera, light and material settings all come from FrameBlock; the
+    // light type and shadow toggle select a specialized program variant
+    ctx.litSamples->poll();
+    ctx.litSamples->begin();
+    if (Shader* litShader = ctx.litShaders.get(litShaderFeatures(frame), *ctx.shaderReloader)) {
+        litShader->use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, ctx.depthMap);
+        drawObjects(ctx, frame, objectOffsets, drawOrder);
+    }
+    ctx.litSamples->end();
+
+    if (frame.depthPrepass) {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    // 2c. Extra camera views, sharing this frame's shadow map
+    if (ctx.multiViewTimer->poll())
+        renderStats.multiViewMs.store(ctx.multiViewTimer->lastMs(), std::memory_order_relaxed);
+    if (frame.viewCount > 0 && viewOffset >= 0) {
+        ctx.multiViewTimer->begin();
+        renderMultiView(ctx, frame, objectOffsets, viewOffset);
+        ctx.multiViewTimer->end();
+        renderStats.multiViewViews.store(frame.viewCount, std::memory_order_relaxed);
+    }
+
+    // The ring region can be reused once the GPU is past this point
+    stream.endFrame();
+    renderStats.uploadBytes.store((unsigned int)stream.uploadBytes, std::memory_order_relaxed);
+    renderStats.fenceWaits.store(stream.fenceWaits, std::memory_order_relaxed);
+    renderStats.fenceWaitMs.store(stream.fenceWaitMs, std::memory_order_relaxed);
+    renderStats.arenaBytes.store((unsigned int)ctx.frameArena.get().used(), std::memory_order_relaxed);
+
+    // Post passes are always filled, even in wireframe mode
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    // 3. Upscale the lit pass to the window
+    if (frame.dynamicResolution) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, frame.width, frame.height);
+        glDisable(GL_DEPTH_TEST);
+        ctx.upscaleShader.use();
+        ctx.upscaleShader.setVec2("uvScale", glm::vec2((float)sceneWidth / ctx.sceneTargetWidth, (float)sceneHeight / ctx.sceneTargetHeight));
+        ctx.upscaleShader.setVec2("texelSize", glm::vec2(1.0f / ctx.sceneTargetWidth, 1.0f / ctx.sceneTargetHeight));
+        ctx.upscaleShader.setFloat("sharpness", renderScale < 1.0f ? frame.upscaleSharpness : 0.0f);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, ctx.sceneColor);
+        glBindVertexArray(ctx.quadVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    // Debug depth visualization
+    if (frame.renderMode == 1) {
+        // Render shadow map depth as full screen
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        ctx.debugDepthShader.use();
+        ctx.debugDepthShader.setFloat("near_plane", frame.lightNear);
+        ctx.debugDepthShader.setFloat("far_plane", frame.lightFar);
+        ctx.debugDepthShader.setFloat("uvScale", shadowScale);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, ctx.depthMap);
+        glBindVertexArray(ctx.quadVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+    }
+    
+    // Shadow map overlay (bottom-right corner)
+    if (frame.showShadowMapOverlay && frame.renderMode == 0) {
+        // Disable depth test for overlay
+        glDisable(GL_DEPTH_TEST);
+        
+        // Set viewport for overlay (bottom-right corner)
+        int overlayPixelWidth = (int)(frame.width * frame.overlaySize);
+        int overlayPixelHeight = (int)(frame.height * frame.overlaySize);
+        glViewport(frame.width - overlayPixelWidth, 0, overlayPixelWidth, overlayPixelHeight);
+        
+        ctx.debugDepthShader.use();
+        ctx.debugDepthShader.setFloat("near_plane", frame.lightNear);
+        ctx.debugDepthShader.setFloat("far_plane", frame.lightFar);
+        ctx.debugDepthShader.setFloat("uvScale", shadowScale);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, ctx.depthMap);
+        glBindVertexArray(ctx.quadVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+        
+        // Restore viewport and depth test
+        glViewport(0, 0, frame.width, frame.height);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    ctx.frameTimer->end();
+    renderStats.gpuFrameMs.store(ctx.frameTimer->lastMs(), std::memory_order_relaxed);
+    renderStats.litSamples.store(ctx.litSamples->lastResult, std::memory_order_relaxed);
+    renderStats.litVariants.store(ctx.litShaders.compiledCount(), std::memory_order_relaxed);
+    renderStats.resolutionScale.store(renderScale, std::memory_order_relaxed);
+    renderStats.shadowMapScale.store(shadowScale, std::memory_order_relaxed);
+
+    // 4. Queue readbacks of the finished frame, before the UI is drawn over
+    // it. Outside the GPU timer, so captures don't skew the frame budget.
+    FrameCapture& capture = *ctx.capture;
+    capture.update();
+    if (frame.captureColor != CAPTURE_OFF || frame.captureDepth != CAPTURE_OFF) {
+        CaptureRequest request;
+        request.frameIndex = frame.frameIndex;
+        request.colorFormat = frame.captureColor;
+        request.width = frame.width;
+        request.height = frame.height;
+        request.depthFormat = frame.captureDepth;
+        request.depthFramebuffer = ctx.depthMapFBO;
+        request.depthWidth = shadowWidth;
+        request.depthHeight = shadowHeight;
+        request.wait = frame.captureWait;
+        capture.capture(request);
+    }
+    renderStats.captureMs.store(capture.lastMs, std::memory_order_relaxed);
+    renderStats.captureBusySlots.store(capture.busySlots(), std::memory_order_relaxed);
+    renderStats.capturesWritten.store(capture.written.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    renderStats.capturesDropped.store(capture.dropped.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    renderStats.capturesWaited.store(capture.waited.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    renderStats.captureFailures.store(capture.failed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// Create, upload or destroy the ImGui textures (font atlas pages) that asked
+// for it. Runs while the UI thread waits in waitForTextureUpdates(), so the
+// backend's Status and TexID writes can't race with its next NewFrame().
+#if IMGUI_VERSION_NUM >= 19200
+void updateUITextures(FrameSnapshot& frame) {
+    for (ImTextureData* tex : *frame.uiTextures)
+        if (tex->Status != ImTextureStatus_OK)
+            ImGui_ImplOpenGL3_UpdateTexture(tex);
+}
+#endif
+
+// Render thread: owns the GL context and consumes snapshots in order
+void renderThreadMain(GLFWwindow* window, RenderContext* ctx, SnapshotQueue* snapshots) {
+    glfwMakeContextCurrent(window);
+
+    auto lastSwap = std::chrono::steady_clock::now();
+    while (true) {
+        auto waitStart = std::chrono::steady_clock::now();
+        FrameSnapshot* frame = snapshots->beginRead();
+        if (frame == nullptr)
+            break;
+        auto submitStart = std::chrono::steady_clock::now();
+
+#if IMGUI_VERSION_NUM >= 19200
+        if (frame->uiTextureUpdates) {
+            updateUITextures(*frame);
+            snapshots->texturesUpdated();
+        }
+#endif
+        renderFrame(*ctx, *frame);
+        ImGui_ImplOpenGL3_RenderDrawData(&frame->uiDrawData);
+
+        // Everything the snapshot feeds has been submitted; let the UI thread reuse it
+        snapshots->endRead();
+        glfwSwapBuffers(window);
+
+        auto submitEnd = std::chrono::steady_clock::now();
+        ThreadTimings::accumulate(threadTimings.submitWaitMs, millisecondsBetween(waitStart, submitStart));
+        ThreadTimings::accumulate(threadTimings.submitMs, millisecondsBetween(submitStart, submitEnd));
+        ThreadTimings::accumulate(threadTimings.frameMs, millisecondsBetween(lastSwap, submitEnd));
+        lastSwap = submitEnd;
+    }
+
+    // Release GL objects while this thread still has the context current
+    // (the capture ring first writes out frames still in flight)
+    ctx->capture.reset();
+    ctx->uniformStream.reset();
+    ctx->frameTimer.reset();
+    ctx->multiViewTimer.reset();
+    ctx->litSamples.reset();
+    ctx->shaderReloader.reset();
+    ctx->litShaders.clear();
+    ctx->depthShader = Shader();
+    ctx->debugDepthShader = Shader();
+    ctx->upscaleShader = Shader();
+    ImGui_ImplOpenGL3_Shutdown();
+    glfwMakeContextCurrent(NULL);
+}
+
+int main(int argc, char** argv) {
+    // --replay <file>: play a recording back and exit when it ends
+    const char* replayPath = nullptr;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], "--replay") == 0)
+            replayPath = argv[++i];
+    }
+
     // Initialize GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -310,19 +1262,18 @@ int main() {
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
+    // Create the backend's GL objects (and font atlas) now, while this thread
+    // still owns the context; ImGui_ImplOpenGL3_NewFrame() is never called.
+    ImGui_ImplOpenGL3_CreateDeviceObjects();
 
     glEnable(GL_DEPTH_TEST);
 
-    Shader depthShader("shaders/depth.vert", "shaders/depth.frag");
-    Shader shadowShader("shaders/shadow.vert", "shaders/shadow.frag");
-    Shader debugDepthShader("shaders/debug_depth.vert", "shaders/debug_depth.frag");
+    RenderContext ctx;
 
-    unsigned int depthMapFBO;
-    glGenFramebuffers(1, &depthMapFBO);
+    glGenFramebuffers(1, &ctx.depthMapFBO);
 
-    unsigned int depthMap;
-    glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
+    glGenTextures(1, &ctx.depthMap);
+    glBindTexture(GL_TEXTURE_2D, ctx.depthMap);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -331,36 +1282,69 @@ int main() {
     float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
     glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.depthMapFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, ctx.depthMap, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    unsigned int cubeVAO = loadCubeVAO();
-    unsigned int planeVAO = loadPlaneVAO();
-    unsigned int quadVAO = loadQuadVAO();
+    ctx.cubeVAO = loadCubeVAO();
+    ctx.planeVAO = loadPlaneVAO();
+    ctx.quadVAO = loadQuadVAO();
+    createMultiViewTarget(ctx);
 
-    shadowShader.use();
-    shadowShader.setInt("shadowMap", 0);
-    
-    // Set default light attenuation values
-    shadowShader.setFloat("constant", lightConstant);
-    shadowShader.setFloat("linear", lightLinear);
-    shadowShader.setFloat("quadratic", lightQuadratic);
-    
-    debugDepthShader.use();
-    debugDepthShader.setInt("depthMap", 0);
+    ctx.uniformStream.reset(new StreamBuffer(GL_UNIFORM_BUFFER, UNIFORM_STREAM_SIZE));
+    renderStats.persistentMapping = ctx.uniformStream->isPersistent();
+    ctx.frameTimer.reset(new GpuTimer());
+    ctx.multiViewTimer.reset(new GpuSpanTimer());
+    ctx.litSamples.reset(new GpuQueryRing(GL_SAMPLES_PASSED));
+    ctx.shaderReloader.reset(new ShaderReloader(&shaderReloadStatus));
+    ctx.occlusionCuller.reset(new OcclusionCuller(workerThreadCount()));
+    ctx.capture.reset(new FrameCapture(CAPTURE_DIRECTORY, workerThreadCount()));
+    setupShaders(ctx);
+    // Other lit variants compile in the background on first use, with this
+    // one standing in for the ones that only change lighting or shadows
+    ctx.litShaders.build((lightType == 1 ? LIT_POINT_LIGHT : 0) | (enableShadows ? LIT_SHADOWS : 0));
+
+    // Hand the GL context over to the render thread. From here on this thread
+    // only handles input, ImGui and animation, and publishes frame snapshots.
+    SnapshotQueue snapshots;
+    glfwMakeContextCurrent(NULL);
+    std::thread renderThread(renderThreadMain, window, &ctx, &snapshots);
 
+    ShaderWatcher shaderWatcher(ENGINE_SHADER_DIR);
+    unsigned int shaderErrorsVersion = 0;
+    std::string shaderErrors;
+
+    registerRecordedParams();
+    if (replayPath != nullptr && !recorder.startReplay(replayPath, camera, simulationTime, SCR_WIDTH, SCR_HEIGHT)) {
+        std::cout << recorder.error << std::endl;
+        glfwSetWindowShouldClose(window, true);
+    }
+
+    unsigned int frameIndex = 0;
+    uint64_t allocationTotal = AllocationCounter::total().load();
+    unsigned int allocationsLastFrame = 0;
+    unsigned int framesWithoutAllocations = 0;
     while (!glfwWindowShouldClose(window)) {
+        auto waitStart = std::chrono::steady_clock::now();
+        FrameSnapshot* frame = snapshots.beginWrite();
+        if (frame == nullptr)
+            break;
+        auto buildStart = std::chrono::steady_clock::now();
+
+        glfwPollEvents();
+
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        processInput(window);
+        FrameInput input = processInput(window);
+        if (shaderWatcher.poll() && autoReloadShaders)
+            reloadShadersRequested = true;
+        shaderReloadStatus.fetch(shaderErrorsVersion, shaderErrors);
 
         // Start the Dear ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
@@ -506,10 +1490,96 @@ int main() {
                 ImGui::Separator();
                 ImGui::Text("Shadows");
                 ImGui::Checkbox("Enable Shadows", &enableShadows);
+                ImGui::Text("Lit shader variants compiled: %d", renderStats.litVariants.load());
                 ImGui::DragFloat("Shadow Bias", &shadowBias, 0.0001f, 0.0f, 0.1f, "%.4f");
                 ImGui::Separator();
                 ImGui::Checkbox("Wireframe Mode", &wireframeMode);
                 ImGui::Separator();
+                ImGui::Text("Dynamic Resolution");
+                ImGui::Checkbox("Enable Dynamic Resolution", &dynamicResolution);
+                if (dynamicResolution) {
+                    ImGui::DragFloat("Frame Budget (ms)", &targetFrameMs, 0.1f, 1.0f, 100.0f);
+                    ImGui::SliderFloat("Min Scale", &minResolutionScale, 0.25f, 1.0f);
+                    ImGui::SliderFloat("Sharpness", &upscaleSharpness, 0.0f, 1.0f);
+                }
+                ImGui::Text("Scale: %.0f%% (shadow map %.0f%%)", renderStats.resolutionScale.load() * 100.0f, renderStats.shadowMapScale.load() * 100.0f);
+                ImGui::Separator();
+                ImGui::Text("Depth Prepass");
+                ImGui::Checkbox("Enable Depth Prepass", &depthPrepass);
+                ImGui::SliderInt("Overdraw Layers", &overdrawLayers, 0, 32);
+                ImGui::Text("Lit fragments: %llu", (unsigned long long)renderStats.litSamples.load());
+                // It edits recorded parameters itself, which a replay couldn't reproduce
+                if (prepassBenchmark.running()) {
+                    ImGui::Text("Benchmark running...");
+                } else if (recorder.active()) {
+                    ImGui::TextDisabled("Benchmark unavailable while recording or replaying");
+                } else if (ImGui::Button("Run Prepass Benchmark")) {
+                    prepassBenchmark.start(depthPrepass, overdrawLayers);
+                }
+                if (prepassBenchmark.resultCount > 0 && ImGui::BeginTable("PrepassResults", 5, ImGuiTableFlags_Borders)) {
+                    ImGui::TableSetupColumn("Layers");
+                    ImGui::TableSetupColumn("Off (ms)");
+                    ImGui::TableSetupColumn("On (ms)");
+                    ImGui::TableSetupColumn("Off fragments");
+                    ImGui::TableSetupColumn("On fragments");
+                    ImGui::TableHeadersRow();
+                    for (int i = 0; i + 1 < prepassBenchmark.resultCount; i += 2) {
+                        const PrepassBenchmark::Result& off = prepassBenchmark.results[i];
+                        const PrepassBenchmark::Result& on = prepassBenchmark.results[i + 1];
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn(); ImGui::Text("%d", off.layers);
+                        ImGui::TableNextColumn(); ImGui::Text("%.3f", off.gpuMs);
+                        ImGui::TableNextColumn(); ImGui::Text("%.3f", on.gpuMs);
+                        ImGui::TableNextColumn(); ImGui::Text("%.0f", off.samples);
+                        ImGui::TableNextColumn(); ImGui::Text("%.0f", on.samples);
+                    }
+                    ImGui::EndTable();
+                }
+                ImGui::Separator();
+                ImGui::Text("Occlusion Culling");
+                ImGui::Checkbox("Enable CPU Occlusion Culling", &occlusionCulling);
+                if (occlusionCulling) {
+                    ImGui::Text("Culled: %d objects, %d occluder triangles", renderStats.occlusionCulled.load(), renderStats.occlusionTriangles.load());
+                    ImGui::Text("CPU time: %.3f ms (%s)", renderStats.occlusionMs.load(), OcclusionCuller::usesAvx2() ? "AVX2" : "scalar");
+                }
+                if (occlusionBenchmark.running()) {
+                    ImGui::Text("Benchmark running...");
+                } else if (ImGui::Button("Run Occlusion Benchmark")) {
+                    occlusionBenchmark.start(&cubeOccluder, &planeOccluder, workerThreadCount());
+                }
+                if (!occlusionBenchmark.running() && occlusionBenchmark.resultCount > 0 &&
+                    ImGui::BeginTable("OcclusionResults", 5, ImGuiTableFlags_Borders)) {
+                    ImGui::TableSetupColumn("Boxes");
+                    ImGui::TableSetupColumn("Triangles");
+                    ImGui::TableSetupColumn("Tris/ms");
+                    ImGui::TableSetupColumn("Test (ms)");
+                    ImGui::TableSetupColumn("Culled");
+                    ImGui::TableHeadersRow();
+                    for (int i = 0; i < occlusionBenchmark.resultCount; i++) {
+                        const OcclusionBenchmark::Result& result = occlusionBenchmark.results[i];
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn(); ImGui::Text("%d", result.instances);
+                        ImGui::TableNextColumn(); ImGui::Text("%d", result.triangles);
+                        ImGui::TableNextColumn(); ImGui::Text("%.0f", result.trianglesPerMs);
+                        ImGui::TableNextColumn(); ImGui::Text("%.3f", result.testMs);
+                        ImGui::TableNextColumn(); ImGui::Text("%.1f%%", result.cullRate * 100.0f);
+                    }
+                    ImGui::EndTable();
+                }
+                ImGui::Separator();
+                ImGui::Text("Multi-View");
+                ImGui::SliderInt("Views", &multiViewCount, 0, MAX_VIEWS);
+                if (multiViewCount > 0) {
+                    ImGui::SliderFloat("View Distance", &multiViewDistance, 2.0f, 30.0f);
+                    ImGui::SliderFloat("View Height", &multiViewHeight, -2.0f, 15.0f);
+                    ImGui::Text("Routing: %s", ctx.viewportArray ? "gl_ViewportIndex (viewport array)" : "clip-space remap (instanced)");
+                    // Show only the rows in use, view 0 top left (GL textures start at the bottom)
+                    int rows = (multiViewCount + MULTI_VIEW_COLUMNS - 1) / MULTI_VIEW_COLUMNS;
+                    float width = 320.0f;
+                    ImGui::Image((ImTextureID)(intptr_t)ctx.multiViewColor, ImVec2(width, width * rows / MULTI_VIEW_COLUMNS),
+                                 ImVec2(0.0f, 1.0f), ImVec2(1.0f, 1.0f - (float)rows / MULTI_VIEW_COLUMNS));
+                }
+                ImGui::Separator();
                 ImGui::Text("Debug Visualization");
                 const char* renderModes[] = { "Normal", "Light Depth Map", "Camera Depth" };
                 ImGui::Combo("Render Mode", &renderMode, renderModes, 3);
@@ -526,204 +1596,155 @@ int main() {
             
             ImGui::Separator();
             if (ImGui::Button("Reload Shaders")) {
-                try {
-                    depthShader = Shader("shaders/depth.vert", "shaders/depth.frag");
-                    shadowShader = Shader("shaders/shadow.vert", "shaders/shadow.frag");
-                    shadowShader.use();
-                    shadowShader.setInt("shadowMap", 0);
-                    ImGui::Text("Shaders reloaded successfully!");
-                } catch (const std::exception& e) {
-                    ImGui::Text("Error reloading shaders!");
-                }
+                // Compiled on the render thread, which owns the GL context
+                reloadShadersRequested = true;
+            }
+            ImGui::SameLine();
+            ImGui::Checkbox("Auto Reload", &autoReloadShaders);
+            if (shaderReloadStatus.pending.load() > 0)
+                ImGui::Text("Compiling %d program(s)...", shaderReloadStatus.pending.load());
+            if (!shaderErrors.empty()) {
+                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+                ImGui::TextWrapped("%s", shaderErrors.c_str());
+                ImGui::PopStyleColor();
             }
             
             ImGui::Separator();
             ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+            ImGui::Text("GPU frame: %.2f ms", renderStats.gpuFrameMs.load());
+            int measuredViews = renderStats.multiViewViews.load();
+            if (multiViewCount > 0 && measuredViews > 0) {
+                float multiViewMs = renderStats.multiViewMs.load();
+                ImGui::Text("Multi-view pass: %.2f ms (%.3f ms per view)", multiViewMs, multiViewMs / measuredViews);
+            }
+            if (ImGui::CollapsingHeader("Recording")) {
+                if (recorder.recording()) {
+                    ImGui::Text("Recording frame %d", recorder.frameCount());
+                    if (ImGui::Button("Stop Recording"))
+                        recorder.stopRecording(RECORDING_PATH);
+                } else if (recorder.replaying()) {
+                    ImGui::Text("Replaying frame %d / %d", recorder.frameCount(), recorder.replayLength());
+                    if (ImGui::Button("Stop Replay"))
+                        recorder.stopReplay();
+                } else {
+                    if (ImGui::Button("Record")) {
+                        prepassBenchmark.stop(depthPrepass, overdrawLayers);
+                        recorder.startRecording(camera, simulationTime, SCR_WIDTH, SCR_HEIGHT);
+                    }
+                    ImGui::SameLine();
+                    if (ImGui::Button("Replay")) {
+                        prepassBenchmark.stop(depthPrepass, overdrawLayers);
+                        recorder.startReplay(RECORDING_PATH, camera, simulationTime, SCR_WIDTH, SCR_HEIGHT);
+                    }
+                }
+                ImGui::Text("File: %s (fixed %.1f ms steps)", RECORDING_PATH, InputRecorder::FIXED_TIMESTEP * 1000.0f);
+                if (!recorder.error.empty())
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", recorder.error.c_str());
+                const InputRecorder::ReplaySummary& summary = recorder.summary;
+                if (summary.frames > 0) {
+                    ImGui::Text("Last replay: %d frames", summary.frames);
+                    ImGui::Text("Frame: %.2f ms mean, %.2f ms p95, %.2f ms p99", summary.meanFrameMs, summary.p95FrameMs, summary.p99FrameMs);
+                    ImGui::Text("GPU:   %.2f ms mean", summary.meanGpuMs);
+                }
+            }
+            if (ImGui::CollapsingHeader("Capture")) {
+                ImGui::Text("Color:");
+                ImGui::SameLine(); ImGui::RadioButton("Off##color", &captureColorFormat, CAPTURE_OFF);
+                ImGui::SameLine(); ImGui::RadioButton("PNG", &captureColorFormat, CAPTURE_PNG);
+                ImGui::SameLine(); ImGui::RadioButton("Raw##color", &captureColorFormat, CAPTURE_RAW);
+                ImGui::Text("Shadow depth:");
+                ImGui::SameLine(); ImGui::RadioButton("Off##depth", &captureDepthFormat, CAPTURE_OFF);
+                ImGui::SameLine(); ImGui::RadioButton("EXR", &captureDepthFormat, CAPTURE_EXR);
+                ImGui::SameLine(); ImGui::RadioButton("Raw##depth", &captureDepthFormat, CAPTURE_RAW);
+                if (ImGui::Button("Capture Frame"))
+                    captureFrameRequested = true;
+                ImGui::SameLine();
+                ImGui::Checkbox("Continuous", &captureContinuous);
+                ImGui::Text("Written: %u, dropped: %u, in flight: %d/%d", renderStats.capturesWritten.load(),
+                            renderStats.capturesDropped.load(), renderStats.captureBusySlots.load(), FrameCapture::SLOTS);
+                ImGui::Text("Replay frames that waited for a slot: %u", renderStats.capturesWaited.load());
+                ImGui::Text("Render thread: %.3f ms/frame", renderStats.captureMs.load());
+                ImGui::Text("Output: %s/", CAPTURE_DIRECTORY);
+                if (renderStats.captureFailures.load() > 0)
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%u file(s) could not be written", renderStats.captureFailures.load());
+            }
+            if (ImGui::CollapsingHeader("Threading")) {
+                ImGui::Text("UI build:      %.2f ms (waiting %.2f ms)", threadTimings.buildMs.load(), threadTimings.buildWaitMs.load());
+                ImGui::Text("Render submit: %.2f ms (waiting %.2f ms)", threadTimings.submitMs.load(), threadTimings.submitWaitMs.load());
+                ImGui::Text("Frame:         %.2f ms", threadTimings.frameMs.load());
+                ImGui::Text("Overlap:       %.2f ms (%.0f%% of ideal)", threadTimings.overlapMs(), threadTimings.overlapRatio() * 100.0f);
+            }
+            if (ImGui::CollapsingHeader("Uniform Streaming")) {
+                ImGui::Text("Mode: %s", renderStats.persistentMapping.load() ? "persistent coherent map" : "unsynchronized map");
+                ImGui::Text("Upload: %u bytes/frame", renderStats.uploadBytes.load());
+                ImGui::Text("Fence waits: %u (last %.3f ms)", renderStats.fenceWaits.load(), renderStats.fenceWaitMs.load());
+            }
+            if (ImGui::CollapsingHeader("Memory")) {
+                if (AllocationCounter::enabled()) {
+                    ImGui::Text("Heap allocations last frame: %u", allocationsLastFrame);
+                    ImGui::Text("Frames without allocations: %u", framesWithoutAllocations);
+                } else {
+                    ImGui::Text("Allocation counter disabled (ENGINE_TRACK_ALLOCATIONS)");
+                }
+                ImGui::Text("Snapshot arena: %.1f / %.1f KB", frame->arena.used() / 1024.0f, frame->arena.capacity() / 1024.0f);
+                ImGui::Text("Render arena: %.1f KB", renderStats.arenaBytes.load() / 1024.0f);
+            }
             
             ImGui::End();
         }
 
+        // Recording logs this frame's input and the UI's edits; replaying
+        // swaps both for the logged ones. Either way time advances in whole
+        // fixed steps, so the same frames come out on every run.
+        if (recorder.active()) {
+            recorder.addReplayTiming(deltaTime * 1000.0f, renderStats.gpuFrameMs.load());
+            int steps = 0;
+            if (!recorder.processFrame(input, deltaTime, steps) && replayPath != nullptr)
+                glfwSetWindowShouldClose(window, true);
+            deltaTime = steps * InputRecorder::FIXED_TIMESTEP;
+        }
+        applyCameraInput(input);
+        simulationTime += deltaTime;
+
         // Apply animations
         if (animateLight) {
-            float time = glfwGetTime() * animationSpeed;
+            float time = simulationTime * animationSpeed;
             lightPos.x = cos(time) * 10.0f;
             lightPos.z = sin(time) * 10.0f;
         }
         
         if (animateCube) {
-            cubeRotation.y = fmod(glfwGetTime() * 30.0f * animationSpeed, 360.0f);
-        }
-
-        // Enable/disable wireframe
-        if (wireframeMode) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        } else {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            cubeRotation.y = fmod(simulationTime * 30.0f * animationSpeed, 360.0f);
         }
+        if (recorder.recording())
+            recorder.syncParams();
 
-        // 1. Render depth of scene to texture (from light's perspective)
-        glm::mat4 lightProjection = glm::ortho(-lightOrthoSize, lightOrthoSize, -lightOrthoSize, lightOrthoSize, lightNear, lightFar);
-        glm::mat4 lightView = glm::lookAt(lightPos, lightTarget, lightUp);
-        glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-
-        depthShader.use();
-        depthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        // Render scene for depth map
-        glm::mat4 model = glm::mat4(1.0f);
-        depthShader.setMat4("model", model);
-        glBindVertexArray(planeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, cubePosition);
-        model = glm::rotate(model, glm::radians(cubeRotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(cubeRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(cubeRotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, cubeScale);
-        depthShader.setMat4("model", model);
-        glBindVertexArray(cubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // Render second cube for depth map
-        if (showSecondCube) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, cube2Position);
-            model = glm::rotate(model, glm::radians(cube2Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(cube2Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(cube2Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-            model = glm::scale(model, cube2Scale);
-            depthShader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
+        prepassBenchmark.update(depthPrepass, overdrawLayers, renderStats.gpuFrameMs.load(), renderStats.litSamples.load());
+        buildFrameSnapshot(*frame);
+        frame->frameIndex = frameIndex++;
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // 2. Render scene as normal using the generated depth/shadow map
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-        glClearColor(clearColor.r, clearColor.g, clearColor.b, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        shadowShader.use();
-        glm::mat4 projection;
-        if (projectionType == 0) {
-            // Perspective projection
-            projection = glm::perspective(glm::radians(cameraFOV), (float)SCR_WIDTH / (float)SCR_HEIGHT, cameraNear, cameraFar);
-        } else {
-            // Orthographic projection
-            float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
-            projection = glm::ortho(-orthoSize * aspect, orthoSize * aspect, -orthoSize, orthoSize, cameraNear, cameraFar);
-        }
-        glm::mat4 view = camera.GetViewMatrix();
-        shadowShader.setMat4("projection", projection);
-        shadowShader.setMat4("view", view);
-        shadowShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-        shadowShader.setVec3("viewPos", camera.Position);
-        shadowShader.setVec3("lightPos", lightPos);
-        
-        // Set light properties
-        shadowShader.setInt("lightType", lightType);
-        shadowShader.setFloat("constant", lightConstant);
-        shadowShader.setFloat("linear", lightLinear);
-        shadowShader.setFloat("quadratic", lightQuadratic);
-        shadowShader.setFloat("ambientStrength", ambientStrength);
-        shadowShader.setFloat("specularStrength", specularStrength);
-        shadowShader.setInt("shininess", specularShininess);
-        shadowShader.setFloat("shadowBias", shadowBias);
-        shadowShader.setBool("enableShadows", enableShadows);
-        
-        // Floor
-        model = glm::mat4(1.0f);
-        shadowShader.setMat4("model", model);
-        shadowShader.setVec3("objectColor", floorColor);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
-        glBindVertexArray(planeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // Cube
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, cubePosition);
-        model = glm::rotate(model, glm::radians(cubeRotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(cubeRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(cubeRotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, cubeScale);
-        shadowShader.setMat4("model", model);
-        shadowShader.setVec3("objectColor", cubeColor);
-        glBindVertexArray(cubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // Second Cube
-        if (showSecondCube) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, cube2Position);
-            model = glm::rotate(model, glm::radians(cube2Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(cube2Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(cube2Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-            model = glm::scale(model, cube2Scale);
-            shadowShader.setMat4("model", model);
-            shadowShader.setVec3("objectColor", cube2Color);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
+        // Finish ImGui and copy its draw data into the snapshot
+        ImGui::Render();
+        frame->captureUI(ImGui::GetDrawData());
 
-        // Debug depth visualization
-        if (renderMode == 1) {
-            // Render shadow map depth as full screen
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            debugDepthShader.use();
-            debugDepthShader.setFloat("near_plane", lightNear);
-            debugDepthShader.setFloat("far_plane", lightFar);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, depthMap);
-            glBindVertexArray(quadVAO);
-            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-            glBindVertexArray(0);
-        }
-        
-        // Shadow map overlay (bottom-right corner)
-        if (showShadowMapOverlay && renderMode == 0) {
-            // Disable depth test for overlay
-            glDisable(GL_DEPTH_TEST);
-            
-            // Calculate overlay position and size
-            float overlayWidth = overlaySize;
-            float overlayHeight = overlaySize * ((float)SCR_WIDTH / (float)SCR_HEIGHT);
-            float xPos = 1.0f - overlayWidth - 0.02f;  // 2% margin from right
-            float yPos = -1.0f + overlayHeight + 0.02f; // 2% margin from bottom
-            
-            // Set viewport for overlay (bottom-right corner)
-            int overlayPixelWidth = (int)(SCR_WIDTH * overlaySize);
-            int overlayPixelHeight = (int)(SCR_HEIGHT * overlaySize);
-            glViewport(SCR_WIDTH - overlayPixelWidth, 0, overlayPixelWidth, overlayPixelHeight);
-            
-            debugDepthShader.use();
-            debugDepthShader.setFloat("near_plane", lightNear);
-            debugDepthShader.setFloat("far_plane", lightFar);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, depthMap);
-            glBindVertexArray(quadVAO);
-            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-            glBindVertexArray(0);
-            
-            // Restore viewport and depth test
-            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-            glEnable(GL_DEPTH_TEST);
-        }
+        snapshots.endWrite();
+        snapshots.waitForTextureUpdates();
 
-        // Render ImGui
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        auto buildEnd = std::chrono::steady_clock::now();
+        ThreadTimings::accumulate(threadTimings.buildWaitMs, millisecondsBetween(waitStart, buildStart));
+        ThreadTimings::accumulate(threadTimings.buildMs, millisecondsBetween(buildStart, buildEnd));
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        // Heap allocations on both threads since the previous frame
+        uint64_t newTotal = AllocationCounter::total().load();
+        allocationsLastFrame = (unsigned int)(newTotal - allocationTotal);
+        allocationTotal = newTotal;
+        framesWithoutAllocations = allocationsLastFrame == 0 ? framesWithoutAllocations + 1 : 0;
     }
 
-    // Cleanup
-    ImGui_ImplOpenGL3_Shutdown();
+    // Cleanup (the render thread shuts down the OpenGL backend itself)
+    snapshots.shutdown();
+    renderThread.join();
+
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 